@@ -0,0 +1,134 @@
+// arena.h
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// PolynomialArena - a memory pool for the polynomials of a single computation.
+// (1) The storage of a polynomial comes from a memory resource (std::pmr), which is chosen when
+//     the polynomial is created (or copied): the resource current on the creating thread.
+// (2) While an arena exists, it is the current resource of its thread. Its pools recycle the
+//     blocks of the (many, short-lived) temporary polynomials of the computation, and all of its
+//     memory is released at once when it is destroyed.
+// Polynomials in an arena must not outlive it: results are copied out through outside(). An arena
+// is used by its own thread only (polynomials created by other threads use their own resource).
+// MeteredResource counts the memory of a computation: made current before the computation, it is the
+// upstream of the computation's arenas.
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef arena_H__
+#define arena_H__
+
+#include <atomic>
+#include <memory_resource>
+
+
+// The resource of the polynomials created by this thread (new/delete, unless an arena is active).
+inline std::pmr::memory_resource*& currentPolynomialResource()
+{
+   thread_local std::pmr::memory_resource *resource = std::pmr::new_delete_resource();
+   return resource;
+}
+
+
+// ** class PolynomialArena
+////////////////////////////////////////////////////////////////////////////
+class PolynomialArena
+{
+public:
+   PolynomialArena();
+   ~PolynomialArena();
+
+   PolynomialArena(PolynomialArena const&) = delete;
+   PolynomialArena& operator=(PolynomialArena const&) = delete;
+
+   // Calls f() with the resource that was current before the arena (so the polynomials f creates,
+   // e.g. copies of the results, are not in the arena), and returns its result.
+   template<typename Func>
+   auto outside(Func&& f);
+
+private:
+   std::pmr::memory_resource *m_previous;
+   std::pmr::unsynchronized_pool_resource m_pool;
+};
+
+
+// ** class MeteredResource
+////////////////////////////////////////////////////////////////////////////
+class MeteredResource : public std::pmr::memory_resource
+{
+public:
+   explicit MeteredResource(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+
+   size_t bytes() const; // Allocated (from upstream) and not deallocated yet. May be read by any thread.
+
+private:
+   void* do_allocate(size_t bytes, size_t alignment) override;
+   void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+   bool do_is_equal(std::pmr::memory_resource const &other) const noexcept override;
+
+private:
+   std::pmr::memory_resource *m_upstream;
+   std::atomic<size_t> m_bytes;
+};
+
+
+
+// PolynomialArena - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+inline PolynomialArena::PolynomialArena()
+   : m_previous(currentPolynomialResource()), m_pool(m_previous)
+{
+   currentPolynomialResource() = &m_pool;
+}
+
+inline PolynomialArena::~PolynomialArena()
+{
+   currentPolynomialResource() = m_previous;
+}
+
+template<typename Func>
+auto PolynomialArena::outside(Func&& f)
+{
+   struct Restore
+   {
+      std::pmr::memory_resource *arena;
+      ~Restore() {currentPolynomialResource() = arena;}
+   } restore {currentPolynomialResource()};
+   currentPolynomialResource() = m_previous;
+   return f();
+}
+
+
+// MeteredResource - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+inline MeteredResource::MeteredResource(std::pmr::memory_resource *upstream)
+   : m_upstream(upstream), m_bytes(0)
+{
+}
+
+inline size_t MeteredResource::bytes() const
+{
+   return m_bytes;
+}
+
+inline void* MeteredResource::do_allocate(size_t bytes, size_t alignment)
+{
+   void *p = m_upstream->allocate(bytes, alignment);
+   m_bytes += bytes;
+   return p;
+}
+
+inline void MeteredResource::do_deallocate(void *p, size_t bytes, size_t alignment)
+{
+   m_upstream->deallocate(p, bytes, alignment);
+   m_bytes -= bytes;
+}
+
+inline bool MeteredResource::do_is_equal(std::pmr::memory_resource const &other) const noexcept
+{
+   return this == &other;
+}
+
+
+#endif
@@ -10,11 +10,19 @@
 #define bachbergers_H__
 
 #include <deque>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
 #include <initializer_list>
 
 #include "monomials.h"
 #include "polynomials.h"
 #include "division.h"
+#include "parallel.h"
+#include "arena.h"
 
 
 // Declarations
@@ -25,10 +33,224 @@
 template<typename PolyRing, typename MonomialOrdering>
 Polynomial<PolyRing, MonomialOrdering> makeSPolynomial(Polynomial<PolyRing, MonomialOrdering> const &f, Polynomial<PolyRing, MonomialOrdering> const &g);
 
-// Produces a Groebner Basis for a given set of generators for an ideal in K[x1, x2. ,,,., xn]. This is the most naive
-// implementation of Buchberger's algroithm.
-template<typename GeneratorsContainer>
-GeneratorsContainer runBuchbergers(GeneratorsContainer&& ideal_generators);
+// Pair selection strategies
+// A strategy assigns a weight to every critical pair, and the pair with the smallest weight is reduced
+// first (ties are broken by the order in which the pairs were formed).
+//   lcm_degree - The total degree of the LCM of the leading monomials.
+//   sugar      - The sugar of the S-Polynomial (the degree it would have, had the input been homogenized).
+
+// The pairs are reduced in the order they were formed.
+struct FirstPairStrategy
+{
+   static unsigned int weight(unsigned int lcm_degree, unsigned int sugar) {return 0;}
+};
+
+// Buchberger's normal strategy (for degree orderings): the pair with the lowest LCM degree.
+struct NormalStrategy
+{
+   static unsigned int weight(unsigned int lcm_degree, unsigned int sugar) {return lcm_degree;}
+};
+
+// Sugar strategy (Giovini et al.): the pair with the lowest sugar. Unlike the normal strategy, it
+// behaves well for non-degree orderings (e.g. lex).
+struct SugarStrategy
+{
+   static unsigned int weight(unsigned int lcm_degree, unsigned int sugar) {return sugar;}
+};
+
+// Reduction policies
+// A policy computes the remainder of an S-Polynomial w.r.t the basis (whose leading monomials are indexed,
+// see divide).
+
+// The remainder of divide() (over Q, the coefficients of the remainders may grow quickly).
+struct PlainReduction
+{
+   template<typename PolynomialType, typename BasisContainer, typename Reducers>
+   static PolynomialType remainder(PolynomialType p, BasisContainer const &basis, Reducers const &index)
+   {
+      return std::get<0>(divide(std::move(p), basis, index));
+   }
+};
+
+// The fraction-free remainder of primitiveRemainder() (primitive, up to a constant factor).
+struct PrimitiveReduction
+{
+   template<typename PolynomialType, typename BasisContainer, typename Reducers>
+   static PolynomialType remainder(PolynomialType p, BasisContainer const &basis, Reducers const &index)
+   {
+      return primitiveRemainder(std::move(p), basis, index);
+   }
+};
+
+// Counters of a run of Buchberger's algorithm.
+struct BuchbergerStatistics
+{
+   size_t reductions = 0;      // S-Polynomials divided by the basis.
+   size_t zero_reductions = 0; // Of which, reduced to zero.
+   size_t pairs_discarded = 0; // Pairs never formed (or dropped) due to the product and chain criteria.
+};
+
+// Observes and bounds a run of runBuchbergers (from other threads). The run publishes its progress after
+// every pair, and checks the limits before every pair: once one is reached, or cancel() was called, it stops
+// and returns a partial basis - the generators and the remainders found so far (which generate the ideal,
+// but are not a Groebner basis).
+struct BuchbergerMonitor
+{
+   enum class Stop : unsigned int {None = 0, Cancelled = 1, Deadline = 2, Memory = 3};
+
+   // Progress
+   std::atomic<size_t> basis_size {0};
+   std::atomic<size_t> pairs_remaining {0};
+   std::atomic<unsigned int> degree {0}; // The total degree of the LCM of the latest pair.
+
+   // Limits
+   std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+   MeteredResource const *memory = nullptr; // The memory of the run (e.g. current while it runs), bounded by memory_limit.
+   size_t memory_limit = std::numeric_limits<size_t>::max();
+
+   void cancel() {m_cancelled = true;}
+   Stop stopped() const {return m_stopped;} // Why the run stopped early (None while it runs, or if it completed).
+
+   bool shouldStop(); // Used by the run: checks the limits (and records the reason to stop).
+
+private:
+   std::atomic<bool> m_cancelled {false};
+   std::atomic<Stop> m_stopped {Stop::None};
+};
+
+// A record of a run of runBuchbergers: the pairs whose S-Polynomials were not reduced to zero, and the
+// reducer of every reduction step. Replaying it (see replayBuchbergers) on generators of the same shape -
+// other coefficients, or the image modulo another prime - repeats only these reductions, with no critical
+// pairs and no reductions to zero. Monomials are kept as powers, so a trace may be replayed in another ring.
+struct BuchbergerTrace
+{
+   using Powers = std::vector<unsigned int>;
+
+   struct Reduction
+   {
+      Powers monomial; // The leading monomial that was reduced,
+      size_t reducer;  // by this element of the basis.
+   };
+
+   struct Step
+   {
+      size_t i, j; // The pair whose remainder is the next element of the basis.
+      std::vector<Reduction> reductions;
+   };
+
+   size_t generators = 0;
+   std::vector<Powers> leading; // The leading monomials of the basis (empty for a zero generator).
+   std::vector<Step> steps;
+};
+
+template<typename PolyRing>
+BuchbergerTrace::Powers powersOf(Monomial<PolyRing> const &m);
+
+// The total degree of a polynomial (the maximal total degree of its terms).
+template<typename PolynomialType>
+unsigned int totalDegree(PolynomialType const &p);
+
+
+// ** class CriticalPairs
+// The pairs (i, j) of basis elements whose S-Polynomials are yet to be reduced. Installing a new element
+// follows Gebauer-Moeller: pairs which are redundant by Buchberger's product criterion (coprime leading
+// monomials) or chain criterion are never queued, and elements whose leading monomial is divisible by
+// the new one are retired (they no longer form new pairs).
+template<typename PolynomialType, typename SelectionStrategy=NormalStrategy>
+class CriticalPairs
+{
+public:
+   using MonomialType = typename std::decay_t<decltype(LM(std::declval<PolynomialType const&>()))>;
+
+   struct Pair
+   {
+      size_t i, j;
+      MonomialType lcm;
+      unsigned int sugar;
+      unsigned int weight;
+      size_t serial;
+   };
+
+   // Installs basis[k] (the basis must hold all of 0..k), whose sugar is given.
+   template<typename BasisContainer>
+   void install(BasisContainer const &basis, size_t k, unsigned int sugar);
+
+   bool empty() const;
+   size_t size() const;
+   Pair pop(); // The pair chosen by the strategy.
+   std::vector<Pair> popLowest(); // All the pairs of the lowest weight (in the order they were formed).
+   bool active(size_t i) const;
+   size_t discarded() const; // The number of pairs discarded so far.
+
+private:
+   std::vector<Pair> m_pairs;
+   std::vector<MonomialType> m_leading;
+   std::vector<unsigned int> m_sugar;
+   std::vector<bool> m_active;
+   size_t m_serial = 0;
+   size_t m_discarded = 0;
+};
+
+// ** class TracedReducers
+// Looks up reducers in a ReducerIndex (like divide does), and records them.
+template<typename PolyRing>
+class TracedReducers
+{
+public:
+   static const size_t npos = ReducerIndex<PolyRing>::npos;
+
+   TracedReducers(ReducerIndex<PolyRing> const &index, std::vector<BuchbergerTrace::Reduction> &reductions);
+   size_t find(Monomial<PolyRing> const &m) const;
+
+private:
+   ReducerIndex<PolyRing> const &m_index;
+   std::vector<BuchbergerTrace::Reduction> &m_reductions;
+};
+
+// ** class ReplayedReducers
+// Serves the reducers recorded for a step. A monomial other than the next recorded one is not reduced,
+// so if a recorded monomial is never looked up (e.g. its coefficient vanished), the rest are never served.
+template<typename PolyRing>
+class ReplayedReducers
+{
+public:
+   static const size_t npos = ReducerIndex<PolyRing>::npos;
+
+   ReplayedReducers(std::vector<BuchbergerTrace::Reduction> const &reductions);
+   size_t find(Monomial<PolyRing> const &m) const;
+   bool complete() const; // All the recorded reducers were served.
+
+private:
+   std::vector<BuchbergerTrace::Reduction> const &m_reductions;
+   mutable size_t m_next;
+};
+
+// Produces a Groebner Basis for a given set of generators for an ideal in K[x1, x2. ,,,., xn].
+// The result holds the generators followed by the (non-zero) remainders of S-Polynomials, in the order
+// they were found. Elements are never removed (makeMinimalGroebner drops the redundant ones).
+// The order in which critical pairs are reduced is set by SelectionStrategy, and the remainders are
+// computed by ReductionPolicy. If a trace is given, the run is recorded into it, and if a monitor is
+// given, the run may stop early (see BuchbergerMonitor).
+template<typename SelectionStrategy=NormalStrategy, typename ReductionPolicy=PlainReduction, typename GeneratorsContainer>
+std::decay_t<GeneratorsContainer> runBuchbergers(GeneratorsContainer&& ideal_generators, BuchbergerStatistics *statistics=nullptr,
+                                                 BuchbergerTrace *trace=nullptr, BuchbergerMonitor *monitor=nullptr);
+
+// Same, where the S-Polynomials of a batch of pairs (all the pairs of the lowest weight) are reduced
+// concurrently by the pool, against the basis as it was before the batch. The remainders are then reduced by
+// the elements added since, and inserted in the order of the pairs, so the result does not depend on the
+// number of threads (though it may differ from the one of runBuchbergers).
+template<typename SelectionStrategy=NormalStrategy, typename ReductionPolicy=PlainReduction, typename GeneratorsContainer>
+std::decay_t<GeneratorsContainer> runParallelBuchbergers(GeneratorsContainer&& ideal_generators, ThreadPool &pool,
+                                                         BuchbergerStatistics *statistics=nullptr);
+
+// Replays a trace of runBuchbergers on generators of the same shape, and produces the same basis as the
+// traced run would have. Fails (leaving a partial basis) if the generators do not follow the trace: a
+// leading monomial differs, or a recorded reduction step is impossible. Whether the pairs that were reduced
+// to zero in the traced run are reduced to zero again is not checked (e.g. modular results are verified
+// by other primes).
+template<typename ReductionPolicy=PlainReduction, typename GeneratorsContainer>
+bool replayBuchbergers(GeneratorsContainer&& ideal_generators, BuchbergerTrace const &trace,
+                       std::decay_t<GeneratorsContainer> &groebner_basis, BuchbergerStatistics *statistics=nullptr);
 
 // Converts a given Groebner Basis into a Minimal Gorebner Basis (G with LC(p)=1 for all p in G, and
 // G contains no p for which LT(p) is generated by the ideal of leading terms <LT(G-{p})>.
@@ -42,14 +264,26 @@ template<typename BasisContainer>
 void makeReducedGroebner(BasisContainer &minimal_groebner_basis);
 
 // Utility wrapper for initializer-lists.
-template<typename PolyRing, typename MonomialOrdering>
-std::deque<Polynomial<PolyRing, MonomialOrdering>> runBuchbergers(std::initializer_list<Polynomial<PolyRing, MonomialOrdering>> ideal_generators);
+template<typename SelectionStrategy=NormalStrategy, typename ReductionPolicy=PlainReduction, typename PolyRing, typename MonomialOrdering>
+std::deque<Polynomial<PolyRing, MonomialOrdering>> runBuchbergers(std::initializer_list<Polynomial<PolyRing, MonomialOrdering>> ideal_generators,
+                                                                  BuchbergerStatistics *statistics=nullptr, BuchbergerTrace *trace=nullptr,
+                                                                  BuchbergerMonitor *monitor=nullptr);
 
 
 
 // Definitions
 ////////////////////////////////////////////////////////////////////////////
 
+inline bool BuchbergerMonitor::shouldStop()
+{
+   Stop stop = Stop::None;
+   if (m_cancelled) stop = Stop::Cancelled;
+   else if (std::chrono::steady_clock::now() >= deadline) stop = Stop::Deadline;
+   else if (memory && (memory->bytes() > memory_limit)) stop = Stop::Memory;
+   m_stopped = stop;
+   return stop != Stop::None;
+}
+
 template<typename PolyRing, typename MonomialOrdering>
 Polynomial<PolyRing, MonomialOrdering> makeSPolynomial(Polynomial<PolyRing, MonomialOrdering> const &f, Polynomial<PolyRing, MonomialOrdering> const &g)
 {
@@ -62,81 +296,371 @@ Polynomial<PolyRing, MonomialOrdering> makeSPolynomial(Polynomial<PolyRing, Mono
 }
 
 
-template<typename GeneratorsContainer>
-GeneratorsContainer runBuchbergers(GeneratorsContainer&& ideal_generators)
+template<typename PolyRing>
+BuchbergerTrace::Powers powersOf(Monomial<PolyRing> const &m)
 {
-   GeneratorsContainer groebner_basis {std::forward<GeneratorsContainer>(ideal_generators)};
-   std::deque<typename std::decay_t<GeneratorsContainer>::value_type> newly_added;
+   BuchbergerTrace::Powers powers(variablesOf<PolyRing>());
+   for (size_t i = 0; i < powers.size(); ++i)
+      powers[i] = m[i];
+   return powers;
+}
 
-   do
+template<typename PolynomialType>
+unsigned int totalDegree(PolynomialType const &p)
+{
+   unsigned int degree = 0;
+   for (size_t i = 0; i < p.terms(); ++i)
+      degree = std::max(degree, p.getMonomial(i).powersSum());
+   return degree;
+}
+
+
+template<typename PolynomialType, typename SelectionStrategy>
+template<typename BasisContainer>
+void CriticalPairs<PolynomialType, SelectionStrategy>::install(BasisContainer const &basis, size_t k, unsigned int sugar)
+{
+   auto const &h = *(basis.begin()+k);
+   m_leading.resize(k+1);
+   m_sugar.resize(k+1, 0);
+   m_active.resize(k+1, false);
+   if (h.terms() == 0) return;
+   m_leading[k] = LM(h);
+   m_sugar[k] = sugar;
+   auto const &lm_h = m_leading[k];
+
+   auto coprime = [&lm_h](MonomialType const &m) {return LCM(lm_h, m).powersSum() == lm_h.powersSum()+m.powersSum();};
+   auto makePair = [this, k](size_t i) {
+      Pair pair {i, k, LCM(m_leading[i], m_leading[k]), 0, 0, m_serial++};
+      unsigned int degree = pair.lcm.powersSum();
+      pair.sugar = std::max(m_sugar[i]+degree-m_leading[i].powersSum(), m_sugar[k]+degree-m_leading[k].powersSum());
+      pair.weight = SelectionStrategy::weight(degree, pair.sugar);
+      return pair;
+   };
+
+   // New pairs: a pair whose LCM is divisible by the LCM of another new pair is redundant (unless its
+   // leading monomials are coprime, in which case it is dropped below by the product criterion anyway).
+   std::vector<Pair> candidates, kept;
+   for (size_t i = 0; i < k; ++i)
+      if (m_active[i]) candidates.push_back(makePair(i));
+   for (size_t c = 0; c < candidates.size(); ++c)
    {
-      newly_added.clear();
-      for (size_t i = 0; i < groebner_basis.size(); ++i)
+      auto const &pair = candidates[c];
+      bool redundant = false;
+      if (!coprime(m_leading[pair.i]))
       {
-         for (size_t j = i+1; j < groebner_basis.size(); ++j)
-         {
-            auto reminder = std::get<0>(divide(makeSPolynomial(groebner_basis[i], groebner_basis[j]), groebner_basis));
-            if (reminder.terms() != 0)
-               newly_added.push_back(reminder);
-         }
+         for (size_t other = c+1; (other < candidates.size()) && !redundant; ++other)
+            redundant = divides(candidates[other].lcm, pair.lcm);
+         for (size_t other = 0; (other < kept.size()) && !redundant; ++other)
+            redundant = divides(kept[other].lcm, pair.lcm);
       }
-      std::copy(newly_added.begin(), newly_added.end(), std::back_inserter(groebner_basis));
-   } while(!newly_added.empty());
+      if (!redundant) kept.push_back(pair);
+   }
+   kept.erase(std::remove_if(kept.begin(), kept.end(), [&](Pair const &pair) {return coprime(m_leading[pair.i]);}), kept.end());
+   m_discarded += candidates.size()-kept.size();
 
-   return groebner_basis;
+   // Chain criterion: (i, j) is redundant if LM(h) | lcm(i, j), and both (i, h) and (j, h) have a smaller LCM.
+   size_t queued = m_pairs.size();
+   m_pairs.erase(std::remove_if(m_pairs.begin(), m_pairs.end(), [&](Pair const &pair) {
+                    return divides(lm_h, pair.lcm) &&
+                           (LCM(m_leading[pair.i], lm_h) != pair.lcm) &&
+                           (LCM(m_leading[pair.j], lm_h) != pair.lcm);
+                 }), m_pairs.end());
+   m_discarded += queued-m_pairs.size();
+   std::copy(kept.begin(), kept.end(), std::back_inserter(m_pairs));
+
+   for (size_t i = 0; i < k; ++i)
+      if (m_active[i] && divides(lm_h, m_leading[i])) m_active[i] = false;
+   m_active[k] = true;
 }
 
+template<typename PolynomialType, typename SelectionStrategy>
+bool CriticalPairs<PolynomialType, SelectionStrategy>::empty() const
+{
+   return m_pairs.empty();
+}
 
-template<typename BasisContainer>
-void makeMinimalGroebner(BasisContainer &groebner_basis)
+template<typename PolynomialType, typename SelectionStrategy>
+size_t CriticalPairs<PolynomialType, SelectionStrategy>::size() const
+{
+   return m_pairs.size();
+}
+
+template<typename PolynomialType, typename SelectionStrategy>
+typename CriticalPairs<PolynomialType, SelectionStrategy>::Pair CriticalPairs<PolynomialType, SelectionStrategy>::pop()
+{
+   auto selected = std::min_element(m_pairs.begin(), m_pairs.end(), [](Pair const &p1, Pair const &p2) {
+                      return (p1.weight != p2.weight) ? (p1.weight < p2.weight) : (p1.serial < p2.serial);
+                   });
+   Pair pair = std::move(*selected);
+   m_pairs.erase(selected);
+   return pair;
+}
+
+template<typename PolynomialType, typename SelectionStrategy>
+std::vector<typename CriticalPairs<PolynomialType, SelectionStrategy>::Pair> CriticalPairs<PolynomialType, SelectionStrategy>::popLowest()
+{
+   std::vector<Pair> lowest;
+   if (m_pairs.empty()) return lowest;
+   lowest.push_back(pop());
+   unsigned int weight = lowest.front().weight;
+   m_pairs.erase(std::remove_if(m_pairs.begin(), m_pairs.end(), [&lowest, weight](Pair &pair) {
+                    if (pair.weight != weight) return false;
+                    lowest.push_back(std::move(pair));
+                    return true;
+                 }), m_pairs.end());
+   return lowest;
+}
+
+template<typename PolynomialType, typename SelectionStrategy>
+bool CriticalPairs<PolynomialType, SelectionStrategy>::active(size_t i) const
+{
+   return m_active[i];
+}
+
+template<typename PolynomialType, typename SelectionStrategy>
+size_t CriticalPairs<PolynomialType, SelectionStrategy>::discarded() const
+{
+   return m_discarded;
+}
+
+
+template<typename PolyRing>
+TracedReducers<PolyRing>::TracedReducers(ReducerIndex<PolyRing> const &index, std::vector<BuchbergerTrace::Reduction> &reductions)
+   : m_index(index), m_reductions(reductions)
+{
+}
+
+template<typename PolyRing>
+size_t TracedReducers<PolyRing>::find(Monomial<PolyRing> const &m) const
+{
+   size_t i = m_index.find(m);
+   if (i != npos) m_reductions.push_back(BuchbergerTrace::Reduction {powersOf(m), i});
+   return i;
+}
+
+template<typename PolyRing>
+ReplayedReducers<PolyRing>::ReplayedReducers(std::vector<BuchbergerTrace::Reduction> const &reductions)
+   : m_reductions(reductions), m_next(0)
+{
+}
+
+template<typename PolyRing>
+size_t ReplayedReducers<PolyRing>::find(Monomial<PolyRing> const &m) const
 {
-  auto i = groebner_basis.begin();
-   while (i != groebner_basis.end())
+   if (complete()) return npos;
+   auto const &reduction = m_reductions[m_next];
+   for (size_t i = 0; i < reduction.monomial.size(); ++i)
+      if (m[i] != reduction.monomial[i]) return npos;
+   ++m_next;
+   return reduction.reducer;
+}
+
+template<typename PolyRing>
+bool ReplayedReducers<PolyRing>::complete() const
+{
+   return m_next == m_reductions.size();
+}
+
+
+template<typename SelectionStrategy, typename ReductionPolicy, typename GeneratorsContainer>
+std::decay_t<GeneratorsContainer> runBuchbergers(GeneratorsContainer&& ideal_generators, BuchbergerStatistics *statistics, BuchbergerTrace *trace,
+                                                 BuchbergerMonitor *monitor)
+{
+   // The S-Polynomials, the remainders and the basis are allocated in an arena, and the basis is copied out.
+   PolynomialArena arena;
+   std::decay_t<GeneratorsContainer> groebner_basis {std::forward<GeneratorsContainer>(ideal_generators)};
+   using PolynomialType = typename std::decay_t<GeneratorsContainer>::value_type;
+   using PolyRing = typename PolynomialType::Ring;
+   CriticalPairs<PolynomialType, SelectionStrategy> pairs;
+   ReducerIndex<PolyRing> index;
+   BuchbergerStatistics counters;
+   if (trace) *trace = BuchbergerTrace {groebner_basis.size(), {}, {}};
+   for (size_t k = 0; k < groebner_basis.size(); ++k)
+   {
+      pairs.install(groebner_basis, k, totalDegree(groebner_basis[k]));
+      if (groebner_basis[k].terms() != 0) index.insert(LM(groebner_basis[k]), k);
+      if (trace) trace->leading.push_back((groebner_basis[k].terms() != 0) ? powersOf(LM(groebner_basis[k])) : BuchbergerTrace::Powers());
+   }
+
+   std::vector<BuchbergerTrace::Reduction> reductions;
+   auto publish = [&] {
+      monitor->basis_size = groebner_basis.size();
+      monitor->pairs_remaining = pairs.size();
+   };
+   if (monitor) publish();
+   while (!pairs.empty())
    {
-      bool removed = false;
-      for (auto j = i+1; (j != groebner_basis.end()) && (!removed); ++j)
+      if (monitor && monitor->shouldStop()) break;
+      auto pair = pairs.pop();
+      if (monitor) monitor->degree = pair.lcm.powersSum();
+      auto spolynomial = makeSPolynomial(groebner_basis[pair.i], groebner_basis[pair.j]);
+      reductions.clear();
+      auto reminder = trace ? ReductionPolicy::remainder(std::move(spolynomial), groebner_basis, TracedReducers<PolyRing>(index, reductions))
+                            : ReductionPolicy::remainder(std::move(spolynomial), groebner_basis, index);
+      ++counters.reductions;
+      if (reminder.terms() != 0)
       {
-         if (divides(LT(*j), LT(*i)))
+         if (trace)
          {
-            removed = true;
-            i = groebner_basis.erase(i);
+            trace->leading.push_back(powersOf(LM(reminder)));
+            trace->steps.push_back(BuchbergerTrace::Step {pair.i, pair.j, reductions});
          }
+         // The sugar of the remainder is bounded by the sugar of the pair (unless the ordering is not degree
+         // compatible, in which case the degree may grow during the reduction).
+         unsigned int sugar = std::max(pair.sugar, totalDegree(reminder));
+         index.insert(LM(reminder), groebner_basis.size());
+         groebner_basis.push_back(std::move(reminder));
+         pairs.install(groebner_basis, groebner_basis.size()-1, sugar);
       }
-      if (!removed)
+      else ++counters.zero_reductions;
+      if (monitor) publish();
+   }
+
+   counters.pairs_discarded = pairs.discarded();
+   if (statistics) *statistics = counters;
+   return arena.outside([&groebner_basis] {return std::decay_t<GeneratorsContainer>(groebner_basis.begin(), groebner_basis.end());});
+}
+
+template<typename SelectionStrategy, typename ReductionPolicy, typename GeneratorsContainer>
+std::decay_t<GeneratorsContainer> runParallelBuchbergers(GeneratorsContainer&& ideal_generators, ThreadPool &pool, BuchbergerStatistics *statistics)
+{
+   std::decay_t<GeneratorsContainer> groebner_basis {std::forward<GeneratorsContainer>(ideal_generators)};
+   using PolynomialType = typename std::decay_t<GeneratorsContainer>::value_type;
+   CriticalPairs<PolynomialType, SelectionStrategy> pairs;
+   ReducerIndex<typename PolynomialType::Ring> index;
+   BuchbergerStatistics counters;
+   for (size_t k = 0; k < groebner_basis.size(); ++k)
+   {
+      pairs.install(groebner_basis, k, totalDegree(groebner_basis[k]));
+      if (groebner_basis[k].terms() != 0) index.insert(LM(groebner_basis[k]), k);
+   }
+
+   while (!pairs.empty())
+   {
+      // The basis and the index are only read while the batch is reduced.
+      auto batch = pairs.popLowest();
+      std::vector<PolynomialType> reminders(batch.size());
+      pool.run(batch.size(), [&](size_t b) {
+         auto const &pair = batch[b];
+         reminders[b] = ReductionPolicy::remainder(makeSPolynomial(groebner_basis[pair.i], groebner_basis[pair.j]), groebner_basis, index);
+      });
+      counters.reductions += batch.size();
+
+      const size_t snapshot = groebner_basis.size();
+      for (size_t b = 0; b < batch.size(); ++b)
       {
-         i->normalize();
-         ++i;
+         auto &reminder = reminders[b];
+         if ((reminder.terms() != 0) && (groebner_basis.size() > snapshot))
+            reminder = ReductionPolicy::remainder(std::move(reminder), groebner_basis, index);
+         if (reminder.terms() == 0)
+         {
+            ++counters.zero_reductions;
+            continue;
+         }
+         unsigned int sugar = std::max(batch[b].sugar, totalDegree(reminder));
+         index.insert(LM(reminder), groebner_basis.size());
+         groebner_basis.push_back(std::move(reminder));
+         pairs.install(groebner_basis, groebner_basis.size()-1, sugar);
       }
    }
+
+   counters.pairs_discarded = pairs.discarded();
+   if (statistics) *statistics = counters;
+   return groebner_basis;
+}
+
+template<typename ReductionPolicy, typename GeneratorsContainer>
+bool replayBuchbergers(GeneratorsContainer&& ideal_generators, BuchbergerTrace const &trace,
+                       std::decay_t<GeneratorsContainer> &groebner_basis, BuchbergerStatistics *statistics)
+{
+   using PolynomialType = typename std::decay_t<GeneratorsContainer>::value_type;
+   using PolyRing = typename PolynomialType::Ring;
+
+   // The recorded reducers are valid once the leading monomials agree with the trace.
+   auto follows = [&trace](PolynomialType const &p, size_t k) {
+      if (p.terms() == 0) return trace.leading[k].empty();
+      return powersOf(LM(p)) == trace.leading[k];
+   };
+
+   groebner_basis = std::decay_t<GeneratorsContainer>(std::forward<GeneratorsContainer>(ideal_generators));
+   if (groebner_basis.size() != trace.generators) return false;
+   for (size_t k = 0; k < groebner_basis.size(); ++k)
+      if (!follows(groebner_basis[k], k)) return false;
+
+   BuchbergerStatistics counters;
+   for (auto const &step: trace.steps)
+   {
+      ReplayedReducers<PolyRing> reducers(step.reductions);
+      auto reminder = ReductionPolicy::remainder(makeSPolynomial(groebner_basis[step.i], groebner_basis[step.j]), groebner_basis, reducers);
+      ++counters.reductions;
+      if (!reducers.complete() || (reminder.terms() == 0) || !follows(reminder, groebner_basis.size())) return false;
+      groebner_basis.push_back(std::move(reminder));
+   }
+
+   if (statistics) *statistics = counters;
+   return true;
 }
 
 
 template<typename BasisContainer>
-void makeReducedGroebner(BasisContainer &minimal_groebner_basis)
+void makeMinimalGroebner(BasisContainer &groebner_basis)
 {
-   for (auto i = minimal_groebner_basis.begin(); i != minimal_groebner_basis.end(); ++i)
+   using PolynomialType = typename BasisContainer::value_type;
+   ReducerIndex<typename PolynomialType::Ring> index;
+   for (size_t i = 0; i < groebner_basis.size(); ++i)
+      index.insert(LM(groebner_basis[i]), i);
+
+   // Among elements with the same leading monomial, the last one is kept.
+   std::vector<bool> redundant(groebner_basis.size());
+   for (size_t i = 0; i < groebner_basis.size(); ++i)
    {
-      for (auto j = minimal_groebner_basis.begin(); j != minimal_groebner_basis.end(); ++j)
+      auto const &lm = LM(groebner_basis[i]);
+      redundant[i] = (index.find(lm, [&](size_t j) {return (j > i) || ((j != i) && (LM(groebner_basis[j]) != lm));}) != index.npos);
+   }
+
+   size_t i = 0;
+   for (auto it = groebner_basis.begin(); it != groebner_basis.end(); ++i)
+   {
+      if (redundant[i]) it = groebner_basis.erase(it);
+      else
       {
-         if (i != j)
-         {
-            for (size_t term = 1; term < j->terms(); ++term)
-            {
-               if (divides(LT(*i), (*j)[term]))
-               {
-                  auto factor = (*j)[term].getCoeff()/LT(*i).getCoeff();
-                  (*j) -= factor*(*i);
-               }
-            }
-         }
+         it->normalize();
+         ++it;
       }
    }
 }
 
-template<typename PolyRing, typename MonomialOrdering>
-std::deque<Polynomial<PolyRing, MonomialOrdering>> runBuchbergers(std::initializer_list<Polynomial<PolyRing, MonomialOrdering>> ideal_generators)
+
+template<typename BasisContainer>
+void makeReducedGroebner(BasisContainer &minimal_groebner_basis)
+{
+   using PolynomialType = typename BasisContainer::value_type;
+   ReducerIndex<typename PolynomialType::Ring> index;
+   for (size_t i = 0; i < minimal_groebner_basis.size(); ++i)
+      index.insert(LM(minimal_groebner_basis[i]), i);
+
+   // In a minimal basis, the leading monomial of p divides no term of the tail of p, so p may be
+   // divided by the whole basis (and the leading monomials never change). The divisions allocate
+   // in an arena, and assigning a reduced element copies it into the element's own storage.
+   PolynomialArena arena;
+   for (auto &p: minimal_groebner_basis)
+   {
+      PolynomialType tail(p);
+      tail -= LT(p);
+      PolynomialType reduced;
+      reduced.appendTerm(LT(p));
+      reduced += std::get<0>(divide(std::move(tail), minimal_groebner_basis, index));
+      p = std::move(reduced);
+   }
+}
+
+template<typename SelectionStrategy, typename ReductionPolicy, typename PolyRing, typename MonomialOrdering>
+std::deque<Polynomial<PolyRing, MonomialOrdering>> runBuchbergers(std::initializer_list<Polynomial<PolyRing, MonomialOrdering>> ideal_generators,
+                                                                  BuchbergerStatistics *statistics, BuchbergerTrace *trace,
+                                                                  BuchbergerMonitor *monitor)
 {
-   return runBuchbergers(std::deque<Polynomial<PolyRing, MonomialOrdering>>(ideal_generators)); 
+   return runBuchbergers<SelectionStrategy, ReductionPolicy>(std::deque<Polynomial<PolyRing, MonomialOrdering>>(ideal_generators), statistics, trace,
+                                                             monitor);
 }
 
 
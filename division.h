@@ -5,6 +5,13 @@
 // (2) safelyDivide - Perform a simple division of one term by another (assuming no reminder).
 // (3) divide - A fully division algorithm.
 //              (Polynomial is being divided by a sequence of polynomials).
+//              The subtractions of (quotient term)*(divisor) are not performed eagerly. Instead,
+//              each of them is a lazy stream of terms, and a heap merges all the streams (and
+//              the dividend), so every step of the division costs O(log #streams).
+//              The divisor of a term is looked up in a ReducerIndex (see reducers.h).
+// (4) primitiveRemainder - A fraction-free reduction: the remainder up to a constant factor, where
+//              no coefficient is divided by a leading coefficient, and the content is removed after
+//              every step (so integer coefficients stay integers, and small).
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma once
@@ -12,9 +19,12 @@
 #define division_H__
 
 #include <tuple>
+#include <vector>
+#include <algorithm>
 
 #include "monomials.h"
 #include "polynomials.h"
+#include "reducers.h"
 
 
 // Divisability (binary relations)
@@ -24,9 +34,7 @@
 template<typename PolyRing>
 bool divides(Monomial<PolyRing> const &divisor, Monomial<PolyRing> const &dividend)
 {
-   for (size_t i = 0; i < PolyRing::VARIABLES; ++i)
-      if (divisor[i] > dividend[i]) return false;
-   return true;
+   return divisor.exponents().divides(dividend.exponents());
 }
 
 // Relation: term | term
@@ -64,9 +72,8 @@ bool divides(Term<PolyRing> const &divisor, Polynomial<PolyRing, MonomialOrderin
 template<typename PolyRing>
 Term<PolyRing> safelyDivide(Term<PolyRing> const &divisor, Term<PolyRing> const &dividend)
 {
-   Term<PolyRing> res;
-   for (size_t i = 0; i < PolyRing::VARIABLES; ++i)
-      res.getMonomial().set(i, dividend.getMonomial()[i]-divisor.getMonomial()[i]);
+   Term<PolyRing> res(dividend);
+   res.getMonomial() /= divisor.getMonomial();
    res.getCoeff() = dividend.getCoeff()/divisor.getCoeff();
    return res;
 }
@@ -76,38 +83,172 @@ Term<PolyRing> safelyDivide(Term<PolyRing> const &divisor, Term<PolyRing> const
 template<typename PolynomialType, typename DivisorsContainer>
 std::tuple<PolynomialType, std::vector<PolynomialType>> divide(PolynomialType dividend, DivisorsContainer&& divisors)
 {
+   ReducerIndex<typename PolynomialType::Ring> index;
+   size_t i = 0;
+   for (auto const &divisor: divisors)
+   {
+      if (divisor.terms() != 0) index.insert(LM(divisor), i);
+      ++i;
+   }
+   return divide(std::move(dividend), std::forward<DivisorsContainer>(divisors), index);
+}
+
+// Same, given an index of the (non-zero) divisors' leading monomials, where the id of a divisor is its position.
+// The index may be any type with find(monomial) and npos (like ReducerIndex), and it is queried once per
+// reduction step, in a descending order of the monomials.
+template<typename PolynomialType, typename DivisorsContainer, typename Reducers>
+std::tuple<PolynomialType, std::vector<PolynomialType>> divide(PolynomialType dividend, DivisorsContainer&& divisors, Reducers const &index)
+{
+   using PolyRing = typename PolynomialType::Ring;
+   using TermType = typename PolynomialType::TermType;
+   using MonomialOrdering = typename PolynomialType::Ordering;
+
    PolynomialType r;
    std::vector<PolynomialType> coeffs(divisors.size());
 
-   while (dividend.terms() != 0)
+   std::vector<PolynomialType const*> divisors_ptrs;
+   for (auto const &divisor: divisors)
+      divisors_ptrs.push_back(&divisor);
+
+   // A stream is multiplier*polynomial (the dividend, or -quotient_term*divisor), and it is represented
+   // in the heap by its next term.
+   struct Stream
+   {
+      PolynomialType const *polynomial;
+      TermType multiplier;
+   };
+   struct Entry
+   {
+      Monomial<PolyRing> monomial;
+      size_t stream;
+      size_t term;
+   };
+   std::vector<Stream> streams;
+   std::vector<Entry> heap;
+   auto less = [](Entry const &a, Entry const &b) {return MonomialOrdering::lessThen(a.monomial, b.monomial);};
+   auto push = [&streams, &heap, &less](size_t stream, size_t term) {
+      Entry entry {streams[stream].multiplier.getMonomial(), stream, term};
+      entry.monomial *= streams[stream].polynomial->getMonomial(term);
+      heap.push_back(std::move(entry));
+      std::push_heap(heap.begin(), heap.end(), less);
+   };
+
+   streams.push_back(Stream {&dividend, TermType(1, Monomial<PolyRing>())});
+   if (dividend.terms() != 0) push(0, 0);
+
+   while (!heap.empty())
    {
-      bool division_occurred = false;
-      for (size_t i = 0; (i < divisors.size()) && (!division_occurred); ++i)
+      // The leading term of the (lazily updated) dividend.
+      Monomial<PolyRing> current = heap.front().monomial;
+      typename AccumulatorOf<typename PolyRing::Coefficient>::type sum;
+      while (!heap.empty() && (heap.front().monomial == current))
       {
-         auto &curr_divisor = *(divisors.begin()+i);
-         if (divides(LT(curr_divisor), LT(dividend)))
-         {
-            auto d = safelyDivide(LT(curr_divisor), LT(dividend)); 
-            coeffs[i] += d;
-            dividend -= (d*curr_divisor);
-            division_occurred = true;
-         }
+         std::pop_heap(heap.begin(), heap.end(), less);
+         Entry popped = std::move(heap.back());
+         heap.pop_back();
+         auto const &stream = streams[popped.stream];
+         sum.addProduct(stream.multiplier.getCoeff(), stream.polynomial->getCoeff(popped.term));
+         if (popped.term+1 < stream.polynomial->terms())
+            push(popped.stream, popped.term+1);
       }
-      if (!division_occurred)
+      auto coeff = sum.value();
+      if (PolyRing::isZero(coeff)) continue;
+
+      TermType leading(coeff, std::move(current));
+      size_t i = index.find(leading.getMonomial());
+      if (i != index.npos)
       {
-         r += LT(dividend);
-         dividend -= LT(dividend);
+         auto &curr_divisor = *divisors_ptrs[i];
+         auto d = safelyDivide(LT(curr_divisor), leading);
+         coeffs[i].appendTerm(d);
+         if (curr_divisor.terms() > 1)
+         {
+            streams.push_back(Stream {&curr_divisor, -1*d});
+            push(streams.size()-1, 1);
+         }
       }
+      else
+         r.appendTerm(std::move(leading));
    }
    return std::make_tuple(r, coeffs);
 }
 
-
 template<typename PolynomialType>
 std::tuple<PolynomialType, std::vector<PolynomialType>> divide(PolynomialType dividend, std::initializer_list<PolynomialType> divisors)
 {
    return divide(dividend, std::vector<PolynomialType>(divisors));
 }
 
+// The remainder of the division by the divisors (up to a constant factor), by fraction-free steps:
+// p <-- LC(g)*p - LC(p)*t*g. The result is primitive (see Polynomial::makePrimitive).
+// The index is queried like the one of divide.
+template<typename PolynomialType, typename DivisorsContainer, typename Reducers>
+PolynomialType primitiveRemainder(PolynomialType dividend, DivisorsContainer const &divisors, Reducers const &index)
+{
+   using TermType = typename PolynomialType::TermType;
+   using Coefficient = typename PolynomialType::Ring::Coefficient;
+
+   // p is what is left to reduce, and r is the remainder so far (both scaled alike).
+   PolynomialType p(std::move(dividend)), r;
+   p.makePrimitive();
+   while (p.terms() != 0)
+   {
+      size_t i = index.find(LM(p));
+      if (i == index.npos)
+      {
+         TermType leading = LT(p);
+         p -= leading;
+         r.appendTerm(std::move(leading));
+         continue;
+      }
+
+      auto const &g = *(divisors.begin()+i);
+      Coefficient a = LC(g), b = LC(p);
+      if constexpr (HasContent<Coefficient>::value)
+      {
+         Coefficient c = Coefficient::gcd(a, b);
+         a /= c;
+         b /= c;
+      }
+      Monomial<typename PolynomialType::Ring> t(LM(p));
+      t /= LM(g);
+      p -= LT(p);
+      p *= a;
+      r *= a;
+      PolynomialType tail(g);
+      tail -= LT(g);
+      p -= TermType(b, t)*tail;
+
+      // Removes the common content of p and r.
+      if constexpr (HasContent<Coefficient>::value)
+      {
+         Coefficient content = 0;
+         for (auto const *q: {&p, &r})
+            for (size_t k = 0; k < q->terms(); ++k)
+               content = Coefficient::gcd(content, q->getCoeff(k));
+         if (!PolynomialType::Ring::isZero(content) && (content != Coefficient(1)))
+         {
+            p *= Coefficient(1)/content;
+            r *= Coefficient(1)/content;
+         }
+      }
+   }
+   r.makePrimitive();
+   return r;
+}
+
+template<typename PolynomialType, typename DivisorsContainer>
+PolynomialType primitiveRemainder(PolynomialType dividend, DivisorsContainer const &divisors)
+{
+   ReducerIndex<typename PolynomialType::Ring> index;
+   size_t i = 0;
+   for (auto const &divisor: divisors)
+   {
+      if (divisor.terms() != 0) index.insert(LM(divisor), i);
+      ++i;
+   }
+   return primitiveRemainder(std::move(dividend), divisors, index);
+}
+
 #endif
 
@@ -0,0 +1,616 @@
+// exponents.h
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Storage policies for the exponent vector of a monomial (selected by PolyRing::Exponents).
+// (1) DenseExponents<N>        - One unsigned int per variable, plus a cached total degree.
+// (2) PackedExponents<N, BITS> - BITS-wide slots packed into 64-bit words. Slot 0 holds the
+//                                total degree, followed by the powers of x1, x2, ..., xn. The
+//                                top bit of every slot is a guard bit, so a power is limited
+//                                to 2^(BITS-1)-1, and comparison, multiplication, divisibility
+//                                and LCM are performed a whole word at a time.
+// (3) RuntimeExponents<INLINE>  - The number of variables is chosen at runtime (by its RingContext).
+//                                Up to INLINE 16-bit powers are kept inline, and beyond that they
+//                                are kept in a pool shared by all the monomials of the ring.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+#ifndef exponents_H__
+#define exponents_H__
+
+#include <array>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <memory_resource>
+
+
+// ** class DenseExponents
+////////////////////////////////////////////////////////////////////////////
+template<size_t N>
+class DenseExponents
+{
+public:
+   static const size_t VARIABLES = N;
+
+   DenseExponents();
+
+   unsigned int get(size_t i) const;
+   void set(size_t i, unsigned int v);
+   unsigned int degree() const;
+   unsigned int const* powers() const; // The N powers, contiguous (e.g. for views of a polynomial's storage).
+
+   bool operator==(DenseExponents<N> const &other) const;
+
+   void multiply(DenseExponents<N> const &other); // Adds the powers of other.
+   void divide(DenseExponents<N> const &other);   // Subtracts the powers of other (assumes other | *this).
+   void lcm(DenseExponents<N> const &other);      // Replaces each power by the maximum of both.
+   bool divides(DenseExponents<N> const &other) const; // *this | other
+
+   bool lexLess(DenseExponents<N> const &other) const;
+   bool grlexLess(DenseExponents<N> const &other) const;
+   bool grevlexLess(DenseExponents<N> const &other) const;
+
+private:
+   std::array<unsigned int, N> m_powers;
+   unsigned int m_degree;
+};
+
+
+// ** class PackedExponents
+////////////////////////////////////////////////////////////////////////////
+template<size_t N, unsigned int BITS=16>
+class PackedExponents
+{
+   static_assert((BITS == 8) || (BITS == 16) || (BITS == 32), "PackedExponents supports 8, 16 or 32 bits per slot");
+
+public:
+   static const size_t VARIABLES = N;
+   static const size_t SLOTS_PER_WORD = 64/BITS;
+   static const size_t WORDS = (N+1+SLOTS_PER_WORD-1)/SLOTS_PER_WORD;
+   static const unsigned int MAX_POWER = (1u << (BITS-1))-1;
+
+   PackedExponents();
+
+   unsigned int get(size_t i) const;
+   void set(size_t i, unsigned int v);
+   unsigned int degree() const;
+
+   bool operator==(PackedExponents<N, BITS> const &other) const;
+
+   void multiply(PackedExponents<N, BITS> const &other);
+   void divide(PackedExponents<N, BITS> const &other);
+   void lcm(PackedExponents<N, BITS> const &other);
+   bool divides(PackedExponents<N, BITS> const &other) const;
+
+   bool lexLess(PackedExponents<N, BITS> const &other) const;
+   bool grlexLess(PackedExponents<N, BITS> const &other) const;
+   bool grevlexLess(PackedExponents<N, BITS> const &other) const;
+
+private:
+   static constexpr uint64_t SLOT_MASK = (uint64_t(1) << BITS)-1;
+   static constexpr uint64_t GUARDS = ~uint64_t(0)/SLOT_MASK*(uint64_t(1) << (BITS-1)); // The top bit of every slot.
+   static constexpr uint64_t DEGREE_MASK = SLOT_MASK << (64-BITS);
+
+   static unsigned int shift(size_t slot) {return 64-BITS*(slot%SLOTS_PER_WORD+1);}
+   unsigned int slot(size_t s) const {return (m_words[s/SLOTS_PER_WORD] >> shift(s)) & SLOT_MASK;}
+   void setSlot(size_t s, unsigned int v);
+   void recomputeDegree();
+
+private:
+   std::array<uint64_t, WORDS> m_words;
+};
+
+
+// ** struct RingContext
+////////////////////////////////////////////////////////////////////////////
+
+// Monomial orderings (as chosen at runtime).
+enum class OrderingId : unsigned int
+{
+   Lex = 0,
+   Grlex = 1,
+   Grevlex = 2
+};
+
+// The shape of a ring whose variables are chosen at runtime. It is set when a problem is loaded, and must
+// not change while monomials of the ring exist.
+struct RingContext
+{
+   size_t variables = 0;
+   OrderingId ordering = OrderingId::Lex;
+   std::pmr::synchronized_pool_resource pool; // Of the powers that are not kept inline.
+};
+
+
+// ** class RuntimeExponents
+////////////////////////////////////////////////////////////////////////////
+template<size_t INLINE=8>
+class RuntimeExponents
+{
+public:
+   static const size_t VARIABLES = 64; // An upper bound (the actual number is variables()).
+   static const unsigned int MAX_POWER = 0xffff;
+
+   static RingContext& context();
+   static size_t variables();
+   static void load(size_t variables, OrderingId ordering); // Sets the context.
+
+   RuntimeExponents();
+   RuntimeExponents(RuntimeExponents<INLINE> const &other);
+   RuntimeExponents(RuntimeExponents<INLINE> &&other) noexcept; // Takes over pooled powers.
+   RuntimeExponents<INLINE>& operator=(RuntimeExponents<INLINE> const &other);
+   RuntimeExponents<INLINE>& operator=(RuntimeExponents<INLINE> &&other) noexcept;
+   ~RuntimeExponents();
+
+   unsigned int get(size_t i) const;
+   void set(size_t i, unsigned int v);
+   unsigned int degree() const;
+
+   bool operator==(RuntimeExponents<INLINE> const &other) const;
+
+   void multiply(RuntimeExponents<INLINE> const &other);
+   void divide(RuntimeExponents<INLINE> const &other);
+   void lcm(RuntimeExponents<INLINE> const &other);
+   bool divides(RuntimeExponents<INLINE> const &other) const;
+
+   bool lexLess(RuntimeExponents<INLINE> const &other) const;
+   bool grlexLess(RuntimeExponents<INLINE> const &other) const;
+   bool grevlexLess(RuntimeExponents<INLINE> const &other) const;
+
+private:
+   static bool pooled() {return s_context.variables > INLINE;}
+   static uint16_t* allocate();
+   uint16_t* powers() {return pooled() ? m_pooled : m_inline;}
+   uint16_t const* powers() const {return pooled() ? m_pooled : m_inline;}
+
+private:
+   static inline RingContext s_context;
+
+   unsigned int m_degree;
+   union
+   {
+      uint16_t m_inline[INLINE];
+      uint16_t *m_pooled;
+   };
+};
+
+
+// DenseExponents - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+template<size_t N>
+DenseExponents<N>::DenseExponents()
+   : m_degree(0)
+{
+   std::fill(m_powers.begin(), m_powers.end(), 0);
+}
+
+template<size_t N>
+unsigned int DenseExponents<N>::get(size_t i) const
+{
+   return m_powers[i];
+}
+
+template<size_t N>
+void DenseExponents<N>::set(size_t i, unsigned int v)
+{
+   m_degree -= m_powers[i];
+   m_degree += v;
+   m_powers[i] = v;
+}
+
+template<size_t N>
+unsigned int DenseExponents<N>::degree() const
+{
+   return m_degree;
+}
+
+template<size_t N>
+unsigned int const* DenseExponents<N>::powers() const
+{
+   return m_powers.data();
+}
+
+template<size_t N>
+bool DenseExponents<N>::operator==(DenseExponents<N> const &other) const
+{
+   for (size_t i = 0; i < N; ++i)
+      if (m_powers[i] != other.m_powers[i]) return false;
+   return true;
+}
+
+template<size_t N>
+void DenseExponents<N>::multiply(DenseExponents<N> const &other)
+{
+   for (size_t i = 0; i < N; ++i)
+      m_powers[i] += other.m_powers[i];
+   m_degree += other.m_degree;
+}
+
+template<size_t N>
+void DenseExponents<N>::divide(DenseExponents<N> const &other)
+{
+   for (size_t i = 0; i < N; ++i)
+      m_powers[i] -= other.m_powers[i];
+   m_degree -= other.m_degree;
+}
+
+template<size_t N>
+void DenseExponents<N>::lcm(DenseExponents<N> const &other)
+{
+   m_degree = 0;
+   for (size_t i = 0; i < N; ++i)
+   {
+      m_powers[i] = std::max(m_powers[i], other.m_powers[i]);
+      m_degree += m_powers[i];
+   }
+}
+
+template<size_t N>
+bool DenseExponents<N>::divides(DenseExponents<N> const &other) const
+{
+   for (size_t i = 0; i < N; ++i)
+      if (m_powers[i] > other.m_powers[i]) return false;
+   return true;
+}
+
+template<size_t N>
+bool DenseExponents<N>::lexLess(DenseExponents<N> const &other) const
+{
+   for (size_t i = 0; i < N; ++i)
+      if (m_powers[i] != other.m_powers[i]) return m_powers[i] < other.m_powers[i];
+   return false;
+}
+
+template<size_t N>
+bool DenseExponents<N>::grlexLess(DenseExponents<N> const &other) const
+{
+   if (m_degree != other.m_degree)
+      return m_degree < other.m_degree;
+   return lexLess(other);
+}
+
+template<size_t N>
+bool DenseExponents<N>::grevlexLess(DenseExponents<N> const &other) const
+{
+   if (m_degree != other.m_degree)
+      return m_degree < other.m_degree;
+   for (int i = N-1; i >= 0; --i)
+      if (m_powers[i] != other.m_powers[i]) return m_powers[i] > other.m_powers[i];
+   return false;
+}
+
+
+// PackedExponents - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+template<size_t N, unsigned int BITS>
+PackedExponents<N, BITS>::PackedExponents()
+{
+   std::fill(m_words.begin(), m_words.end(), 0);
+}
+
+template<size_t N, unsigned int BITS>
+unsigned int PackedExponents<N, BITS>::get(size_t i) const
+{
+   return slot(i+1);
+}
+
+template<size_t N, unsigned int BITS>
+void PackedExponents<N, BITS>::set(size_t i, unsigned int v)
+{
+   assert(v <= MAX_POWER);
+   unsigned int d = degree()-get(i)+v;
+   assert(d <= MAX_POWER);
+   setSlot(i+1, v);
+   setSlot(0, d);
+}
+
+template<size_t N, unsigned int BITS>
+unsigned int PackedExponents<N, BITS>::degree() const
+{
+   return slot(0);
+}
+
+template<size_t N, unsigned int BITS>
+bool PackedExponents<N, BITS>::operator==(PackedExponents<N, BITS> const &other) const
+{
+   return m_words == other.m_words;
+}
+
+template<size_t N, unsigned int BITS>
+void PackedExponents<N, BITS>::multiply(PackedExponents<N, BITS> const &other)
+{
+   // Slots cannot carry into each other as long as no power (or the degree) exceeds MAX_POWER.
+   for (size_t w = 0; w < WORDS; ++w)
+   {
+      m_words[w] += other.m_words[w];
+      assert((m_words[w] & GUARDS) == 0);
+   }
+}
+
+template<size_t N, unsigned int BITS>
+void PackedExponents<N, BITS>::divide(PackedExponents<N, BITS> const &other)
+{
+   assert(other.divides(*this));
+   for (size_t w = 0; w < WORDS; ++w)
+      m_words[w] -= other.m_words[w];
+}
+
+template<size_t N, unsigned int BITS>
+void PackedExponents<N, BITS>::lcm(PackedExponents<N, BITS> const &other)
+{
+   for (size_t w = 0; w < WORDS; ++w)
+   {
+      // The guard bit of a slot survives the subtraction iff this slot >= the other slot.
+      uint64_t ge = (((m_words[w] | GUARDS) - other.m_words[w]) & GUARDS) >> (BITS-1);
+      uint64_t mask = ge*SLOT_MASK;
+      m_words[w] = (m_words[w] & mask) | (other.m_words[w] & ~mask);
+   }
+   recomputeDegree();
+}
+
+template<size_t N, unsigned int BITS>
+bool PackedExponents<N, BITS>::divides(PackedExponents<N, BITS> const &other) const
+{
+   // A borrow clears a guard bit iff some slot of *this is larger than the same slot of other.
+   for (size_t w = 0; w < WORDS; ++w)
+      if ((((other.m_words[w] | GUARDS) - m_words[w]) & GUARDS) != GUARDS) return false;
+   return true;
+}
+
+template<size_t N, unsigned int BITS>
+bool PackedExponents<N, BITS>::lexLess(PackedExponents<N, BITS> const &other) const
+{
+   uint64_t a = m_words[0] & ~DEGREE_MASK, b = other.m_words[0] & ~DEGREE_MASK;
+   if (a != b) return a < b;
+   for (size_t w = 1; w < WORDS; ++w)
+      if (m_words[w] != other.m_words[w]) return m_words[w] < other.m_words[w];
+   return false;
+}
+
+template<size_t N, unsigned int BITS>
+bool PackedExponents<N, BITS>::grlexLess(PackedExponents<N, BITS> const &other) const
+{
+   // The degree occupies the most significant slot, so this is a plain word-wise comparison.
+   for (size_t w = 0; w < WORDS; ++w)
+      if (m_words[w] != other.m_words[w]) return m_words[w] < other.m_words[w];
+   return false;
+}
+
+template<size_t N, unsigned int BITS>
+bool PackedExponents<N, BITS>::grevlexLess(PackedExponents<N, BITS> const &other) const
+{
+   if (degree() != other.degree())
+      return degree() < other.degree();
+   for (int w = WORDS-1; w >= 0; --w)
+   {
+      uint64_t diff = m_words[w] ^ other.m_words[w];
+      if (diff)
+      {
+         // The last differing variable is the least significant differing slot.
+         unsigned int s = (__builtin_ctzll(diff)/BITS)*BITS;
+         return ((m_words[w] >> s) & SLOT_MASK) > ((other.m_words[w] >> s) & SLOT_MASK);
+      }
+   }
+   return false;
+}
+
+template<size_t N, unsigned int BITS>
+void PackedExponents<N, BITS>::setSlot(size_t s, unsigned int v)
+{
+   uint64_t &word = m_words[s/SLOTS_PER_WORD];
+   word &= ~(SLOT_MASK << shift(s));
+   word |= (uint64_t(v) << shift(s));
+}
+
+template<size_t N, unsigned int BITS>
+void PackedExponents<N, BITS>::recomputeDegree()
+{
+   unsigned int d = 0;
+   for (size_t i = 1; i <= N; ++i)
+      d += slot(i);
+   assert(d <= MAX_POWER);
+   setSlot(0, d);
+}
+
+
+// RuntimeExponents - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+template<size_t INLINE>
+RingContext& RuntimeExponents<INLINE>::context()
+{
+   return s_context;
+}
+
+template<size_t INLINE>
+size_t RuntimeExponents<INLINE>::variables()
+{
+   return s_context.variables;
+}
+
+template<size_t INLINE>
+void RuntimeExponents<INLINE>::load(size_t variables, OrderingId ordering)
+{
+   assert(variables <= VARIABLES);
+   context().variables = variables;
+   context().ordering = ordering;
+}
+
+template<size_t INLINE>
+uint16_t* RuntimeExponents<INLINE>::allocate()
+{
+   return static_cast<uint16_t*>(context().pool.allocate(variables()*sizeof(uint16_t), alignof(uint16_t)));
+}
+
+template<size_t INLINE>
+RuntimeExponents<INLINE>::RuntimeExponents()
+   : m_degree(0)
+{
+   if (pooled()) m_pooled = allocate();
+   std::fill(powers(), powers()+std::max(variables(), INLINE), 0);
+}
+
+template<size_t INLINE>
+RuntimeExponents<INLINE>::RuntimeExponents(RuntimeExponents<INLINE> const &other)
+   : m_degree(other.m_degree)
+{
+   if (pooled())
+   {
+      m_pooled = allocate();
+      std::copy(other.m_pooled, other.m_pooled+variables(), m_pooled);
+   }
+   else std::copy(other.m_inline, other.m_inline+INLINE, m_inline);
+}
+
+template<size_t INLINE>
+RuntimeExponents<INLINE>::RuntimeExponents(RuntimeExponents<INLINE> &&other) noexcept
+   : m_degree(other.m_degree)
+{
+   if (pooled())
+   {
+      m_pooled = other.m_pooled;
+      other.m_pooled = nullptr;
+   }
+   else std::copy(other.m_inline, other.m_inline+INLINE, m_inline);
+}
+
+template<size_t INLINE>
+RuntimeExponents<INLINE>& RuntimeExponents<INLINE>::operator=(RuntimeExponents<INLINE> const &other)
+{
+   // Both have the storage of the context, so the powers are copied in place (unless *this was moved from).
+   if (pooled() && (m_pooled == nullptr)) m_pooled = allocate();
+   m_degree = other.m_degree;
+   std::copy(other.powers(), other.powers()+(pooled() ? variables() : INLINE), powers());
+   return *this;
+}
+
+template<size_t INLINE>
+RuntimeExponents<INLINE>& RuntimeExponents<INLINE>::operator=(RuntimeExponents<INLINE> &&other) noexcept
+{
+   m_degree = other.m_degree;
+   if (pooled()) std::swap(m_pooled, other.m_pooled);
+   else std::copy(other.m_inline, other.m_inline+INLINE, m_inline);
+   return *this;
+}
+
+template<size_t INLINE>
+RuntimeExponents<INLINE>::~RuntimeExponents()
+{
+   if (pooled() && (m_pooled != nullptr))
+      context().pool.deallocate(m_pooled, variables()*sizeof(uint16_t), alignof(uint16_t));
+}
+
+template<size_t INLINE>
+unsigned int RuntimeExponents<INLINE>::get(size_t i) const
+{
+   return (i < variables()) ? powers()[i] : 0;
+}
+
+template<size_t INLINE>
+void RuntimeExponents<INLINE>::set(size_t i, unsigned int v)
+{
+   if (i >= variables())
+   {
+      assert(v == 0);
+      return;
+   }
+   assert(v <= MAX_POWER);
+   m_degree -= powers()[i];
+   m_degree += v;
+   powers()[i] = v;
+}
+
+template<size_t INLINE>
+unsigned int RuntimeExponents<INLINE>::degree() const
+{
+   return m_degree;
+}
+
+template<size_t INLINE>
+bool RuntimeExponents<INLINE>::operator==(RuntimeExponents<INLINE> const &other) const
+{
+   return (m_degree == other.m_degree) && std::equal(powers(), powers()+variables(), other.powers());
+}
+
+template<size_t INLINE>
+void RuntimeExponents<INLINE>::multiply(RuntimeExponents<INLINE> const &other)
+{
+   uint16_t *p = powers();
+   uint16_t const *q = other.powers();
+   for (size_t i = 0, n = variables(); i < n; ++i)
+   {
+      assert(p[i]+q[i] <= MAX_POWER);
+      p[i] += q[i];
+   }
+   m_degree += other.m_degree;
+}
+
+template<size_t INLINE>
+void RuntimeExponents<INLINE>::divide(RuntimeExponents<INLINE> const &other)
+{
+   uint16_t *p = powers();
+   uint16_t const *q = other.powers();
+   for (size_t i = 0, n = variables(); i < n; ++i)
+      p[i] -= q[i];
+   m_degree -= other.m_degree;
+}
+
+template<size_t INLINE>
+void RuntimeExponents<INLINE>::lcm(RuntimeExponents<INLINE> const &other)
+{
+   uint16_t *p = powers();
+   uint16_t const *q = other.powers();
+   m_degree = 0;
+   for (size_t i = 0, n = variables(); i < n; ++i)
+   {
+      p[i] = std::max(p[i], q[i]);
+      m_degree += p[i];
+   }
+}
+
+template<size_t INLINE>
+bool RuntimeExponents<INLINE>::divides(RuntimeExponents<INLINE> const &other) const
+{
+   if (m_degree > other.m_degree) return false;
+   uint16_t const *p = powers();
+   uint16_t const *q = other.powers();
+   for (size_t i = 0, n = variables(); i < n; ++i)
+      if (p[i] > q[i]) return false;
+   return true;
+}
+
+template<size_t INLINE>
+bool RuntimeExponents<INLINE>::lexLess(RuntimeExponents<INLINE> const &other) const
+{
+   uint16_t const *p = powers();
+   uint16_t const *q = other.powers();
+   for (size_t i = 0, n = variables(); i < n; ++i)
+      if (p[i] != q[i]) return p[i] < q[i];
+   return false;
+}
+
+template<size_t INLINE>
+bool RuntimeExponents<INLINE>::grlexLess(RuntimeExponents<INLINE> const &other) const
+{
+   if (m_degree != other.m_degree)
+      return m_degree < other.m_degree;
+   return lexLess(other);
+}
+
+template<size_t INLINE>
+bool RuntimeExponents<INLINE>::grevlexLess(RuntimeExponents<INLINE> const &other) const
+{
+   if (m_degree != other.m_degree)
+      return m_degree < other.m_degree;
+   uint16_t const *p = powers();
+   uint16_t const *q = other.powers();
+   for (size_t i = variables(); i-- > 0;)
+      if (p[i] != q[i]) return p[i] > q[i];
+   return false;
+}
+
+
+#endif
@@ -0,0 +1,312 @@
+// f4.h
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Faugere's F4 algorithm for computing a Groebner Basis. Instead of reducing one S-Polynomial
+// at a time, a batch of critical pairs (all the pairs of the lowest LCM degree) is reduced at
+// once, by a row reduction of a sparse Macaulay matrix:
+// (1) Every pair (i, j) contributes the rows (lcm/LM(gi))*gi and (lcm/LM(gj))*gj.
+// (2) Symbolic preprocessing - for every monomial of the matrix which is divisible by a leading
+//     monomial of the basis, a reducer row (m/LM(g))*g is added (whose monomials are added too).
+// (3) The matrix (columns are the monomials, in a descending order) is brought to a row echelon
+//     form. Rows whose leading monomial is not a leading monomial of any original row are new
+//     elements of the basis.
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef f4_H__
+#define f4_H__
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+
+#include "monomials.h"
+#include "polynomials.h"
+#include "division.h"
+#include "buchbergers.h"
+
+
+// Declarations
+////////////////////////////////////////////////////////////////////////////
+
+// Produces a Groebner Basis for a given set of generators, by F4. Like runBuchbergers, the result holds
+// the generators followed by the new elements (so it can be passed to makeMinimalGroebner).
+// In the statistics, a reduction is a critical pair, and a zero reduction is a pair which did not
+// contribute a new element.
+template<typename GeneratorsContainer>
+std::decay_t<GeneratorsContainer> runF4(GeneratorsContainer&& ideal_generators, BuchbergerStatistics *statistics=nullptr);
+
+// Utility wrapper for initializer-lists.
+template<typename PolyRing, typename MonomialOrdering>
+std::deque<Polynomial<PolyRing, MonomialOrdering>> runF4(std::initializer_list<Polynomial<PolyRing, MonomialOrdering>> ideal_generators,
+                                                         BuchbergerStatistics *statistics=nullptr);
+
+
+// ** class MacaulayMatrix
+// Rows are multiples t*g of basis elements, stored sparsely (column, coefficient). Columns are
+// the monomials of all the rows, in a descending order (column 0 is the largest monomial).
+template<typename PolynomialType>
+class MacaulayMatrix
+{
+public:
+   using PolyRing = typename PolynomialType::Ring;
+   using MonomialOrdering = typename PolynomialType::Ordering;
+   using Coefficient = typename PolyRing::Coefficient;
+
+   struct MonomialLess
+   {
+      bool operator()(Monomial<PolyRing> const &m1, Monomial<PolyRing> const &m2) const {return MonomialOrdering::lessThen(m1, m2);}
+   };
+
+   // Adds the row multiplier*g (the column indices are assigned by build()).
+   void addRow(Monomial<PolyRing> const &multiplier, PolynomialType const *g);
+
+   // Symbolic preprocessing: adds reducer rows, taken from the basis elements for which
+   // is_reducer(i) holds, for every monomial that is not a leading monomial of a row yet.
+   // The index holds the leading monomials of the basis.
+   template<typename BasisContainer, typename ReducerPredicate>
+   void addReducers(BasisContainer const &basis, ReducerIndex<PolyRing> const &index, ReducerPredicate&& is_reducer);
+
+   // Row-reduces the matrix, and returns the rows whose leading monomial is new.
+   std::vector<PolynomialType> reduce();
+
+   size_t rows() const;
+   size_t columns() const;
+
+private:
+   struct Row
+   {
+      Monomial<PolyRing> multiplier;
+      PolynomialType const *polynomial;
+      std::vector<std::pair<size_t, Coefficient>> entries;
+   };
+
+   void build();
+
+private:
+   std::vector<Row> m_rows;
+   std::map<Monomial<PolyRing>, size_t, MonomialLess> m_columns; // Monomial --> column
+   std::map<Monomial<PolyRing>, bool, MonomialLess> m_monomials; // Monomial --> is a leading monomial of a row
+   std::vector<Monomial<PolyRing>> m_column_monomials;
+};
+
+
+
+// Definitions
+////////////////////////////////////////////////////////////////////////////
+
+template<typename PolynomialType>
+void MacaulayMatrix<PolynomialType>::addRow(Monomial<PolyRing> const &multiplier, PolynomialType const *g)
+{
+   m_rows.push_back(Row {multiplier, g, {}});
+   for (size_t t = 0; t < g->terms(); ++t)
+   {
+      Monomial<PolyRing> m(multiplier);
+      m *= g->getMonomial(t);
+      auto inserted = m_monomials.emplace(std::move(m), t == 0);
+      if (t == 0) inserted.first->second = true;
+   }
+}
+
+template<typename PolynomialType>
+template<typename BasisContainer, typename ReducerPredicate>
+void MacaulayMatrix<PolynomialType>::addReducers(BasisContainer const &basis, ReducerIndex<PolyRing> const &index, ReducerPredicate&& is_reducer)
+{
+   // The monomials of a reducer row are smaller than its leading monomial, so a single descending pass
+   // visits every monomial (inserting into a std::map does not invalidate the iterator).
+   for (auto it = m_monomials.rbegin(); it != m_monomials.rend(); ++it)
+   {
+      if (it->second) continue;
+      size_t i = index.find(it->first, is_reducer);
+      if (i == index.npos) continue;
+      auto const &g = *(basis.begin()+i);
+      Monomial<PolyRing> multiplier(it->first);
+      multiplier /= LM(g);
+      it->second = true;
+      addRow(multiplier, &g);
+   }
+}
+
+template<typename PolynomialType>
+void MacaulayMatrix<PolynomialType>::build()
+{
+   m_column_monomials.clear();
+   for (auto it = m_monomials.rbegin(); it != m_monomials.rend(); ++it)
+   {
+      m_columns[it->first] = m_column_monomials.size();
+      m_column_monomials.push_back(it->first);
+   }
+   for (auto &row: m_rows)
+   {
+      row.entries.clear();
+      for (size_t t = 0; t < row.polynomial->terms(); ++t)
+      {
+         Monomial<PolyRing> m(row.multiplier);
+         m *= row.polynomial->getMonomial(t);
+         row.entries.emplace_back(m_columns[m], row.polynomial->getCoeff(t));
+      }
+   }
+}
+
+template<typename PolynomialType>
+std::vector<PolynomialType> MacaulayMatrix<PolynomialType>::reduce()
+{
+   build();
+
+   std::vector<bool> original_leading(columns(), false);
+   for (auto const &row: m_rows)
+      original_leading[row.entries.front().first] = true;
+
+   // Pivots are kept monic. A row is reduced in a dense accumulator, by walking its columns from left
+   // to right and eliminating every column that has a pivot.
+   std::vector<std::vector<std::pair<size_t, Coefficient>>> pivots(columns());
+   // The accumulators delay the modular reduction of the row operations (see AccumulatorOf).
+   using Accumulator = typename AccumulatorOf<Coefficient>::type;
+   std::vector<Accumulator> dense(columns());
+   std::vector<bool> occupied(columns(), false);
+   std::vector<size_t> new_pivots;
+
+   // The first row of every leading column becomes a pivot as is (this includes all the reducers).
+   std::vector<Row*> pending;
+   for (auto &row: m_rows)
+   {
+      size_t lead = row.entries.front().first;
+      if (!pivots[lead].empty())
+      {
+         pending.push_back(&row);
+         continue;
+      }
+      Coefficient inverse = Coefficient(1)/row.entries.front().second;
+      pivots[lead] = row.entries;
+      for (auto &entry: pivots[lead]) entry.second *= inverse;
+   }
+
+   for (auto *row: pending)
+   {
+      size_t first = row->entries.front().first;
+      for (auto const &entry: row->entries)
+      {
+         dense[entry.first].add(entry.second);
+         occupied[entry.first] = true;
+      }
+
+      std::vector<std::pair<size_t, Coefficient>> reduced;
+      for (size_t c = first; c < columns(); ++c)
+      {
+         if (!occupied[c]) continue;
+         Coefficient value = dense[c].value();
+         dense[c] = Accumulator();
+         occupied[c] = false;
+         if (PolyRing::isZero(value)) continue;
+         if (!pivots[c].empty())
+         {
+            for (auto const &entry: pivots[c])
+            {
+               if (entry.first == c) continue;
+               dense[entry.first].addProduct(-value, entry.second);
+               occupied[entry.first] = true;
+            }
+         }
+         else reduced.emplace_back(c, value);
+      }
+      if (reduced.empty()) continue;
+
+      size_t lead = reduced.front().first;
+      Coefficient inverse = Coefficient(1)/reduced.front().second;
+      for (auto &entry: reduced) entry.second *= inverse;
+      pivots[lead] = std::move(reduced);
+      if (!original_leading[lead]) new_pivots.push_back(lead);
+   }
+
+   std::vector<PolynomialType> new_elements;
+   for (size_t lead: new_pivots)
+   {
+      PolynomialType p(pivots[lead].size());
+      for (auto const &entry: pivots[lead])
+         p.appendTerm(typename PolynomialType::TermType(entry.second, m_column_monomials[entry.first]));
+      new_elements.push_back(std::move(p));
+   }
+   return new_elements;
+}
+
+template<typename PolynomialType>
+size_t MacaulayMatrix<PolynomialType>::rows() const
+{
+   return m_rows.size();
+}
+
+template<typename PolynomialType>
+size_t MacaulayMatrix<PolynomialType>::columns() const
+{
+   return m_column_monomials.size();
+}
+
+
+template<typename GeneratorsContainer>
+std::decay_t<GeneratorsContainer> runF4(GeneratorsContainer&& ideal_generators, BuchbergerStatistics *statistics)
+{
+   using PolynomialType = typename std::decay_t<GeneratorsContainer>::value_type;
+   using PolyRing = typename PolynomialType::Ring;
+
+   std::decay_t<GeneratorsContainer> groebner_basis {std::forward<GeneratorsContainer>(ideal_generators)};
+   CriticalPairs<PolynomialType, NormalStrategy> pairs;
+   ReducerIndex<PolyRing> index;
+   BuchbergerStatistics counters;
+   for (size_t k = 0; k < groebner_basis.size(); ++k)
+   {
+      pairs.install(groebner_basis, k, totalDegree(groebner_basis[k]));
+      if (groebner_basis[k].terms() != 0) index.insert(LM(groebner_basis[k]), k);
+   }
+
+   while (!pairs.empty())
+   {
+      auto batch = pairs.popLowest();
+
+      // Rows point into the basis, which does not grow before the matrix is reduced.
+      MacaulayMatrix<PolynomialType> matrix;
+      std::vector<std::pair<Monomial<PolyRing>, size_t>> added;
+      auto addHalf = [&](Monomial<PolyRing> const &lcm, size_t i) {
+         Monomial<PolyRing> multiplier(lcm);
+         multiplier /= LM(groebner_basis[i]);
+         auto half = std::make_pair(multiplier, i);
+         if (std::find(added.begin(), added.end(), half) != added.end()) return;
+         added.push_back(half);
+         matrix.addRow(multiplier, &groebner_basis[i]);
+      };
+      for (auto const &pair: batch)
+      {
+         addHalf(pair.lcm, pair.i);
+         addHalf(pair.lcm, pair.j);
+      }
+      matrix.addReducers(groebner_basis, index, [&pairs](size_t i) {return pairs.active(i);});
+
+      auto new_elements = matrix.reduce();
+      counters.reductions += batch.size();
+      counters.zero_reductions += (batch.size() > new_elements.size()) ? (batch.size()-new_elements.size()) : 0;
+
+      for (auto &element: new_elements)
+      {
+         unsigned int sugar = std::max(batch.front().sugar, totalDegree(element));
+         index.insert(LM(element), groebner_basis.size());
+         groebner_basis.push_back(std::move(element));
+         pairs.install(groebner_basis, groebner_basis.size()-1, sugar);
+      }
+   }
+
+   counters.pairs_discarded = pairs.discarded();
+   if (statistics) *statistics = counters;
+   return groebner_basis;
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+std::deque<Polynomial<PolyRing, MonomialOrdering>> runF4(std::initializer_list<Polynomial<PolyRing, MonomialOrdering>> ideal_generators,
+                                                         BuchbergerStatistics *statistics)
+{
+   return runF4(std::deque<Polynomial<PolyRing, MonomialOrdering>>(ideal_generators), statistics);
+}
+
+
+#endif
@@ -0,0 +1,194 @@
+// geobuckets.h
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Geobucket - an accumulator for long sums of polynomials (Yan's geometric buckets).
+// (1) The sum is kept as a few polynomials (buckets), where bucket k holds at most
+//     FIRST_CAPACITY*4^k terms. A summand is merged into the bucket of its size, and a bucket
+//     that grows beyond its capacity is carried into the next one, so every term is merged
+//     O(log #terms) times (instead of once per summand, as in a chain of += on a polynomial).
+// (2) The leading term is found among the leading terms of the buckets, and popping it only
+//     advances the buckets past it, so a reduction (pop the leading term, add a multiple of
+//     a reducer) never rewrites the large buckets.
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef geobuckets_H__
+#define geobuckets_H__
+
+#include <vector>
+#include <utility>
+
+#include "monomials.h"
+#include "polynomials.h"
+
+
+// ** class Geobucket
+////////////////////////////////////////////////////////////////////////////
+template<typename PolynomialType>
+class Geobucket
+{
+public:
+   using TermType = typename PolynomialType::TermType;
+   static const size_t FIRST_CAPACITY = 8;
+
+   Geobucket();
+   explicit Geobucket(PolynomialType const &p);
+
+   void operator+=(PolynomialType const &p);
+   void operator-=(PolynomialType const &p);
+
+   // Adds multiplier*(the terms [begin, ..) of p).
+   void add(TermType const &multiplier, PolynomialType const &p, size_t begin = 0);
+
+   // Removes the leading term of the sum into leading. Returns false when the sum is zero.
+   bool popLeadingTerm(TermType &leading);
+
+   // The sum, as a polynomial. The buckets are merged into one, so summing again is cheap.
+   PolynomialType sum();
+
+private:
+   struct Bucket
+   {
+      PolynomialType polynomial;
+      size_t begin = 0; // The terms before begin were popped.
+
+      size_t terms() const {return polynomial.terms()-begin;}
+      PolynomialType take(); // The remaining terms (the bucket is left empty).
+   };
+
+   static size_t capacity(size_t k);
+   void insert(PolynomialType p);
+
+private:
+   std::vector<Bucket> m_buckets;
+};
+
+
+
+// Geobucket - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+template<typename PolynomialType>
+Geobucket<PolynomialType>::Geobucket() {}
+
+template<typename PolynomialType>
+Geobucket<PolynomialType>::Geobucket(PolynomialType const &p)
+{
+   insert(p);
+}
+
+template<typename PolynomialType>
+void Geobucket<PolynomialType>::operator+=(PolynomialType const &p)
+{
+   insert(p);
+}
+
+template<typename PolynomialType>
+void Geobucket<PolynomialType>::operator-=(PolynomialType const &p)
+{
+   add(TermType(-1, Monomial<typename PolynomialType::Ring>()), p);
+}
+
+template<typename PolynomialType>
+void Geobucket<PolynomialType>::add(TermType const &multiplier, PolynomialType const &p, size_t begin)
+{
+   // Multiplying by a term keeps the order of the terms, so the multiple is built by appending.
+   PolynomialType multiple(p.terms() > begin ? p.terms()-begin : 0);
+   for (size_t i = begin; i < p.terms(); ++i)
+   {
+      TermType t(p[i]);
+      t *= multiplier;
+      if (!PolynomialType::Ring::isZero(t.getCoeff()))
+         multiple.appendTerm(std::move(t));
+   }
+   insert(std::move(multiple));
+}
+
+template<typename PolynomialType>
+bool Geobucket<PolynomialType>::popLeadingTerm(TermType &leading)
+{
+   using MonomialOrdering = typename PolynomialType::Ordering;
+   while (true)
+   {
+      Bucket *top = nullptr;
+      for (auto &bucket: m_buckets)
+         if ((bucket.terms() != 0) &&
+             ((top == nullptr) || MonomialOrdering::lessThen(top->polynomial.getMonomial(top->begin), bucket.polynomial.getMonomial(bucket.begin))))
+            top = &bucket;
+      if (top == nullptr) return false;
+
+      // The terms of the leading monomial (at most one per bucket) are summed, and they may cancel.
+      leading = top->polynomial[top->begin];
+      ++top->begin;
+      for (auto &bucket: m_buckets)
+      {
+         if ((bucket.terms() != 0) && (bucket.polynomial.getMonomial(bucket.begin) == leading.getMonomial()))
+            leading.getCoeff() += bucket.polynomial.getCoeff(bucket.begin++);
+      }
+      if (!PolynomialType::Ring::isZero(leading.getCoeff())) return true;
+   }
+}
+
+template<typename PolynomialType>
+PolynomialType Geobucket<PolynomialType>::sum()
+{
+   // From the smallest bucket up, so every merge is dominated by the larger operand.
+   PolynomialType result;
+   for (auto &bucket: m_buckets)
+      result += bucket.take();
+   m_buckets.clear();
+   insert(result);
+   return result;
+}
+
+template<typename PolynomialType>
+size_t Geobucket<PolynomialType>::capacity(size_t k)
+{
+   return FIRST_CAPACITY << (2*k);
+}
+
+template<typename PolynomialType>
+void Geobucket<PolynomialType>::insert(PolynomialType p)
+{
+   if (p.terms() == 0) return;
+   size_t k = 0;
+   while (capacity(k) < p.terms()) ++k;
+   while (true)
+   {
+      if (k >= m_buckets.size()) m_buckets.resize(k+1);
+      Bucket &bucket = m_buckets[k];
+      if (bucket.terms() == 0)
+      {
+         bucket.polynomial = std::move(p);
+         bucket.begin = 0;
+         return;
+      }
+      p += bucket.take();
+      if (p.terms() <= capacity(k))
+      {
+         bucket.polynomial = std::move(p);
+         return;
+      }
+      ++k;
+   }
+}
+
+template<typename PolynomialType>
+PolynomialType Geobucket<PolynomialType>::Bucket::take()
+{
+   PolynomialType remaining;
+   if (begin == 0)
+      remaining = std::move(polynomial);
+   else
+   {
+      remaining = PolynomialType(terms());
+      for (size_t i = begin; i < polynomial.terms(); ++i)
+         remaining.appendTerm(polynomial[i]);
+   }
+   polynomial = PolynomialType(0);
+   begin = 0;
+   return remaining;
+}
+
+
+#endif
@@ -0,0 +1,434 @@
+// modular.h
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Groebner Bases over Q by a multi-modular computation, which avoids the growth of the
+// coefficients of the intermediate polynomials:
+// (1) The generators are mapped to Z_p for word-size primes, and the reduced Groebner Basis is
+//     computed modulo every prime. The primes are computed in rounds of concurrent threads (one
+//     per core, and at least 3), until the result is verified. The runs of the first round are
+//     traced, and later rounds replay the trace of a lucky prime (see replayBuchbergers).
+// (2) Unlucky primes are discarded: primes that divide a denominator of the input, and primes
+//     whose basis has other leading monomials than the majority of the primes.
+// (3) The images are combined by the Chinese Remainder Theorem, one prime at a time, and the
+//     coefficients over Q are recovered by rational reconstruction. The result is accepted once
+//     it agrees with the image modulo the next prime (a cheap, probabilistic verification).
+// If the primes run out before that, the basis is computed over Q directly.
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef modular_H__
+#define modular_H__
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <future>
+#include <thread>
+#include <functional>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include "monomials.h"
+#include "polynomials.h"
+#include "buchbergers.h"
+#include "primefield.h"
+#include "rationals.h"
+
+
+// Declarations
+////////////////////////////////////////////////////////////////////////////
+
+// The primes of a multi-modular computation (known at compile time, see PrimeField).
+template<uint64_t... PRIMES>
+struct PrimeList {};
+
+// The largest primes below 2^31 (so the accumulators of BarrettField are used).
+using ModularPrimes = PrimeList<2147483647, 2147483629, 2147483587, 2147483579, 2147483563, 2147483549,
+                                2147483543, 2147483497, 2147483489, 2147483477, 2147483423, 2147483399>;
+
+// Counters of a run of runModularGroebner.
+struct ModularStatistics
+{
+   size_t primes = 0;          // Primes whose basis was computed.
+   size_t unlucky_primes = 0;  // Of which, discarded.
+   size_t combined_primes = 0; // Primes used by the reconstruction (including the verifying one).
+   size_t replayed_primes = 0; // Primes computed by replaying the trace of a lucky prime.
+   bool fallback = false;      // The primes ran out, and the basis was computed over Q.
+};
+
+// Rational reconstruction: the fraction a/b = r (mod m) with 2*a^2 < m and 0 < 2*b^2 < m (unique, if any).
+bool reconstructRational(BigInteger const &r, BigInteger const &m, Rational &result);
+
+// The image of p (whose coefficients are in Q) in Z_P. Fails if P divides a denominator.
+template<uint64_t P, typename PolyRing, typename MonomialOrdering>
+bool modularImage(Polynomial<PolyRing, MonomialOrdering> const &p,
+                  Polynomial<PrimeFieldRing<P, PolyRing::VARIABLES, typename PolyRing::Exponents>, MonomialOrdering> &image);
+
+// Sorts a basis by descending leading monomials.
+template<typename BasisContainer>
+void sortByLeadingMonomials(BasisContainer &basis);
+
+// Produces the reduced Groebner Basis (sorted by sortByLeadingMonomials) of an ideal over Q, from
+// its reduced bases modulo the given primes. The generators are polynomials over RationalRing.
+template<typename Primes=ModularPrimes, typename GeneratorsContainer>
+std::deque<typename std::decay_t<GeneratorsContainer>::value_type> runModularGroebner(GeneratorsContainer const &ideal_generators,
+                                                                                      ModularStatistics *statistics=nullptr);
+
+
+// ** struct ModularBasis
+// A reduced Groebner Basis modulo a prime, with the coefficients as integers in [0, prime).
+template<typename PolyRing>
+struct ModularBasis
+{
+   using Element = std::vector<std::pair<Monomial<PolyRing>, uint64_t>>; // Descending monomials.
+
+   uint64_t prime = 0;
+   bool valid = false; // The prime does not divide a denominator of the generators.
+   bool replayed = false; // Computed by replaying a trace (see replayBuchbergers).
+   std::vector<Element> basis; // Descending leading monomials.
+
+   std::vector<Monomial<PolyRing>> leadingMonomials() const;
+};
+
+
+// ** class ChineseRemainders
+// Combines modular bases into residues modulo the product of their primes, and reconstructs the basis over Q.
+template<typename PolynomialType>
+class ChineseRemainders
+{
+public:
+   using PolyRing = typename PolynomialType::Ring;
+
+   ChineseRemainders();
+
+   void add(ModularBasis<PolyRing> const &image);
+
+   // The basis over Q, if all the coefficients can be reconstructed.
+   bool reconstruct(std::deque<PolynomialType> &basis) const;
+
+private:
+   struct MonomialLess
+   {
+      bool operator()(Monomial<PolyRing> const &m1, Monomial<PolyRing> const &m2) const
+      {
+         return PolynomialType::Ordering::lessThen(m1, m2);
+      }
+   };
+
+   BigInteger m_modulus;
+   std::vector<std::map<Monomial<PolyRing>, BigInteger, MonomialLess>> m_residues; // Per element: monomial --> residue.
+};
+
+
+
+// Definitions
+////////////////////////////////////////////////////////////////////////////
+
+inline bool reconstructRational(BigInteger const &r, BigInteger const &m, Rational &result)
+{
+   // The extended Euclidean algorithm on (m, r), stopped at the first remainder a with 2*a^2 < m
+   // (where a = b*r (mod m) holds all along).
+   BigInteger a0 = m, a1 = r%m, b0 = 0, b1 = 1;
+   if (a1.sign() < 0) a1 += m;
+   while (!(BigInteger(2)*a1*a1 < m))
+   {
+      BigInteger q = a0/a1;
+      a0 -= q*a1;
+      std::swap(a0, a1);
+      b0 -= q*b1;
+      std::swap(b0, b1);
+   }
+   if (!(BigInteger(2)*b1*b1 < m) || (gcd(a1, b1) != 1)) return false;
+   result = Rational(a1, b1);
+   return true;
+}
+
+template<uint64_t P, typename PolyRing, typename MonomialOrdering>
+bool modularImage(Polynomial<PolyRing, MonomialOrdering> const &p,
+                  Polynomial<PrimeFieldRing<P, PolyRing::VARIABLES, typename PolyRing::Exponents>, MonomialOrdering> &image)
+{
+   using ModularRing = PrimeFieldRing<P, PolyRing::VARIABLES, typename PolyRing::Exponents>;
+   using Field = typename ModularRing::Coefficient;
+
+   // The monomials keep their order, so the terms are appended.
+   image = Polynomial<ModularRing, MonomialOrdering>(p.terms());
+   for (size_t t = 0; t < p.terms(); ++t)
+   {
+      uint64_t denominator = p.getCoeff(t).denominator().residue(P);
+      if (denominator == 0) return false;
+      Field c = Field(p.getCoeff(t).numerator().residue(P))/Field(denominator);
+      if (c.isZero()) continue;
+      Monomial<ModularRing> m;
+      for (size_t i = 0; i < variablesOf<PolyRing>(); ++i)
+         m.set(i, p.getMonomial(t)[i]);
+      image.appendTerm(Term<ModularRing>(c, std::move(m)));
+   }
+   return true;
+}
+
+template<typename BasisContainer>
+void sortByLeadingMonomials(BasisContainer &basis)
+{
+   using PolynomialType = typename BasisContainer::value_type;
+   std::sort(basis.begin(), basis.end(), [](PolynomialType const &p, PolynomialType const &q) {
+      return PolynomialType::Ordering::lessThen(LM(q), LM(p));
+   });
+}
+
+// The reduced basis modulo P, computed by Buchberger's algorithm. The run is either recorded into a trace,
+// or replays a given trace (or does neither, when both are null). A replay that fails is followed by a full run.
+template<uint64_t P, typename GeneratorsContainer>
+ModularBasis<typename GeneratorsContainer::value_type::Ring> computeModularBasis(GeneratorsContainer const &ideal_generators,
+                                                                                 BuchbergerTrace *record=nullptr, BuchbergerTrace const *replay=nullptr)
+{
+   using PolynomialType = typename GeneratorsContainer::value_type;
+   using PolyRing = typename PolynomialType::Ring;
+   using ModularRing = PrimeFieldRing<P, PolyRing::VARIABLES, typename PolyRing::Exponents>;
+   using ModularPolynomial = Polynomial<ModularRing, typename PolynomialType::Ordering>;
+
+   ModularBasis<PolyRing> result;
+   result.prime = P;
+   std::deque<ModularPolynomial> generators;
+   for (auto const &g: ideal_generators)
+   {
+      ModularPolynomial image;
+      if (!modularImage<P>(g, image)) return result;
+      if (image.terms() != 0) generators.push_back(std::move(image));
+   }
+   result.valid = true;
+   if (generators.empty()) return result;
+
+   std::deque<ModularPolynomial> groebner_basis;
+   result.replayed = replay && replayBuchbergers(generators, *replay, groebner_basis);
+   if (!result.replayed) groebner_basis = runBuchbergers(std::move(generators), nullptr, record);
+   makeMinimalGroebner(groebner_basis);
+   makeReducedGroebner(groebner_basis);
+   sortByLeadingMonomials(groebner_basis);
+
+   for (auto const &g: groebner_basis)
+   {
+      typename ModularBasis<PolyRing>::Element element;
+      for (size_t t = 0; t < g.terms(); ++t)
+      {
+         Monomial<PolyRing> m;
+         for (size_t i = 0; i < variablesOf<PolyRing>(); ++i)
+            m.set(i, g.getMonomial(t)[i]);
+         element.emplace_back(std::move(m), g.getCoeff(t).value());
+      }
+      result.basis.push_back(std::move(element));
+   }
+   return result;
+}
+
+// Whether a basis over Q is mapped to a given modular basis.
+template<typename BasisContainer, typename PolyRing>
+bool agreesWith(BasisContainer const &basis, ModularBasis<PolyRing> const &image)
+{
+   const uint64_t p = image.prime;
+   if (basis.size() != image.basis.size()) return false;
+   for (size_t k = 0; k < basis.size(); ++k)
+   {
+      auto const &g = basis[k];
+      auto const &element = image.basis[k];
+      size_t t = 0;
+      for (size_t s = 0; s < g.terms(); ++s)
+      {
+         uint64_t denominator = g.getCoeff(s).denominator().residue(p);
+         if (denominator == 0) return false;
+         uint64_t value = uint64_t((unsigned __int128)g.getCoeff(s).numerator().residue(p)*inverseModulo(denominator, p)%p);
+         if (value == 0) continue;
+         if ((t == element.size()) || (element[t].first != g.getMonomial(s)) || (element[t].second != value)) return false;
+         ++t;
+      }
+      if (t != element.size()) return false;
+   }
+   return true;
+}
+
+// The computations of the bases modulo the primes (one task per prime).
+template<typename GeneratorsContainer, uint64_t... PRIMES>
+std::vector<std::function<ModularBasis<typename GeneratorsContainer::value_type::Ring>(BuchbergerTrace*, BuchbergerTrace const*)>>
+modularTasks(GeneratorsContainer const &ideal_generators, PrimeList<PRIMES...>)
+{
+   return {[&ideal_generators](BuchbergerTrace *record, BuchbergerTrace const *replay) {
+      return computeModularBasis<PRIMES>(ideal_generators, record, replay);
+   }...};
+}
+
+// The position of a basis of the leading monomials over Q: the ones most primes agree on (or npos if there
+// is no valid basis).
+template<typename PolyRing>
+size_t majorityBasis(std::vector<ModularBasis<PolyRing>> const &images)
+{
+   size_t best = size_t(-1), best_votes = 0;
+   for (size_t i = 0; i < images.size(); ++i)
+   {
+      if (!images[i].valid) continue;
+      auto lms = images[i].leadingMonomials();
+      size_t votes = std::count_if(images.begin(), images.end(), [&lms](ModularBasis<PolyRing> const &image) {
+         return image.valid && (image.leadingMonomials() == lms);
+      });
+      if (votes <= best_votes) continue;
+      best = i;
+      best_votes = votes;
+   }
+   return best;
+}
+
+// Combines the bases of the lucky primes, until a reconstruction is verified by the next prime.
+template<typename PolynomialType>
+bool combineModularBases(std::vector<ModularBasis<typename PolynomialType::Ring>> const &images, std::deque<PolynomialType> &groebner_basis,
+                         ModularStatistics &counters)
+{
+   using PolyRing = typename PolynomialType::Ring;
+
+   // The lucky primes agree with the majority.
+   std::vector<ModularBasis<PolyRing> const*> lucky;
+   size_t majority = majorityBasis(images);
+   if (majority != size_t(-1))
+   {
+      auto lms = images[majority].leadingMonomials();
+      for (auto const &image: images)
+         if (image.valid && (image.leadingMonomials() == lms)) lucky.push_back(&image);
+   }
+   counters.primes = images.size();
+   counters.unlucky_primes = images.size()-lucky.size();
+   counters.combined_primes = 0;
+   counters.replayed_primes = std::count_if(images.begin(), images.end(), [](ModularBasis<PolyRing> const &image) {return image.replayed;});
+
+   ChineseRemainders<PolynomialType> remainders;
+   for (size_t i = 0; i < lucky.size(); ++i)
+   {
+      bool verified = (i > 0) && remainders.reconstruct(groebner_basis) && agreesWith(groebner_basis, *lucky[i]);
+      remainders.add(*lucky[i]);
+      ++counters.combined_primes;
+      if (verified) return true;
+   }
+   return false;
+}
+
+
+// ModularBasis - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+template<typename PolyRing>
+std::vector<Monomial<PolyRing>> ModularBasis<PolyRing>::leadingMonomials() const
+{
+   std::vector<Monomial<PolyRing>> res;
+   for (auto const &element: basis)
+      res.push_back(element.front().first);
+   return res;
+}
+
+
+// ChineseRemainders - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+template<typename PolynomialType>
+ChineseRemainders<PolynomialType>::ChineseRemainders()
+   : m_modulus(1)
+{
+}
+
+template<typename PolynomialType>
+void ChineseRemainders<PolynomialType>::add(ModularBasis<PolyRing> const &image)
+{
+   const uint64_t p = image.prime;
+   const uint64_t inverse = inverseModulo(m_modulus.residue(p), p);
+   m_residues.resize(image.basis.size());
+
+   for (size_t k = 0; k < image.basis.size(); ++k)
+   {
+      auto &residues = m_residues[k];
+      for (auto const &term: image.basis[k])
+         residues.emplace(term.first, BigInteger(0));
+
+      // A monomial that is missing from either side has a zero coefficient there.
+      auto term = image.basis[k].begin();
+      for (auto it = residues.rbegin(); it != residues.rend(); ++it)
+      {
+         uint64_t value = 0;
+         if ((term != image.basis[k].end()) && (term->first == it->first)) value = (term++)->second;
+         // r + M*((value-r)/M mod p) is the residue modulo M*p.
+         uint64_t r = it->second.residue(p);
+         uint64_t difference = (value >= r) ? value-r : value+(p-r);
+         uint64_t t = uint64_t((unsigned __int128)difference*inverse%p);
+         if (t != 0) it->second += m_modulus*BigInteger((long long)t);
+      }
+   }
+   m_modulus *= BigInteger((long long)p);
+}
+
+template<typename PolynomialType>
+bool ChineseRemainders<PolynomialType>::reconstruct(std::deque<PolynomialType> &basis) const
+{
+   basis.clear();
+   for (auto const &residues: m_residues)
+   {
+      PolynomialType g(residues.size());
+      for (auto it = residues.rbegin(); it != residues.rend(); ++it)
+      {
+         Rational c;
+         if (!reconstructRational(it->second, m_modulus, c)) return false;
+         if (!c.isZero()) g.appendTerm(typename PolynomialType::TermType(std::move(c), it->first));
+      }
+      basis.push_back(std::move(g));
+   }
+   return true;
+}
+
+
+template<typename Primes, typename GeneratorsContainer>
+std::deque<typename std::decay_t<GeneratorsContainer>::value_type> runModularGroebner(GeneratorsContainer const &ideal_generators,
+                                                                                      ModularStatistics *statistics)
+{
+   using PolynomialType = typename std::decay_t<GeneratorsContainer>::value_type;
+   using PolyRing = typename PolynomialType::Ring;
+   static_assert(std::is_same<typename PolyRing::Coefficient, Rational>::value, "runModularGroebner requires coefficients over Q");
+
+   // The primes are computed in rounds (a thread per prime), until the result is verified. The primes of the
+   // first round are traced, and the later ones replay the trace of a lucky prime.
+   auto tasks = modularTasks(ideal_generators, Primes());
+   const size_t round = std::max<size_t>(3, std::thread::hardware_concurrency());
+   std::vector<ModularBasis<PolyRing>> images;
+   std::vector<BuchbergerTrace> traces(std::min(round, tasks.size()));
+   BuchbergerTrace const *replay = nullptr;
+   std::deque<PolynomialType> groebner_basis;
+   ModularStatistics counters;
+   bool verified = false;
+   for (size_t next = 0; (next < tasks.size()) && (!verified);)
+   {
+      std::vector<std::future<ModularBasis<PolyRing>>> futures;
+      for (; (next < tasks.size()) && (futures.size() < round); ++next)
+      {
+         BuchbergerTrace *record = (next < traces.size()) ? &traces[next] : nullptr;
+         futures.push_back(std::async(std::launch::async, tasks[next], record, replay));
+      }
+      for (auto &future: futures)
+         images.push_back(future.get());
+      verified = combineModularBases(images, groebner_basis, counters);
+
+      size_t majority = majorityBasis(images);
+      if ((replay == nullptr) && (majority < traces.size())) replay = &traces[majority];
+   }
+
+   if (!verified)
+   {
+      groebner_basis.clear();
+      for (auto const &g: ideal_generators)
+         if (g.terms() != 0) groebner_basis.push_back(g);
+      groebner_basis = runBuchbergers<NormalStrategy, PrimitiveReduction>(std::move(groebner_basis));
+      makeMinimalGroebner(groebner_basis);
+      makeReducedGroebner(groebner_basis);
+      sortByLeadingMonomials(groebner_basis);
+      counters.fallback = true;
+   }
+
+   if (statistics) *statistics = counters;
+   return groebner_basis;
+}
+
+
+#endif
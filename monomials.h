@@ -4,6 +4,8 @@
 // (1) PolyRing is a policy describes the underlying polynomial ring K[x1, x2, ..., xn].
 //     PolyRing::Coefficient - A type for the coefficients field (K).
 //     PolyRing::VARAIBLES   - A constant. The number of varaibles of the polynomials (n).
+//     PolyRing::Exponents   - Optional. The storage of the powers (see exponents.h). When the storage
+//                             is sized at runtime, VARIABLES is only an upper bound (see variablesOf).
 // (2) class Monomial<PolyRing> is a multiplication of (powers of) varaibles.
 ///////////////////////////////////////////////////////////////////////////////////////////
 
@@ -19,6 +21,9 @@
 #include <cassert>
 #include <numeric>
 #include <algorithm>
+#include <type_traits>
+
+#include "exponents.h"
 
 // ** struct PolynomialRing
 ////////////////////////////////////////////////////////////////////////////
@@ -29,9 +34,53 @@ struct PolynomialRing
 {
    using Coefficient = FieldType;
    static const size_t VARIABLES = VARIABLES_COUNT;
+   using Exponents = DenseExponents<VARIABLES_COUNT>;
    static bool isZero(Coefficient a) {return std::fabs(a)<=1e-14;}; // Arbitrary choice.
 };
 
+// Same as PolynomialRing, but monomials are packed into 64-bit words (EXPONENT_BITS per power).
+template<typename FieldType, size_t VARIABLES_COUNT, unsigned int EXPONENT_BITS=16>
+struct PackedPolynomialRing : public PolynomialRing<FieldType, VARIABLES_COUNT>
+{
+   using Exponents = PackedExponents<VARIABLES_COUNT, EXPONENT_BITS>;
+};
+
+// Same as PolynomialRing, but the number of variables (and the ordering, for RuntimeOrder) is chosen at
+// runtime: RuntimePolynomialRing<...>::Exponents::load(variables, ordering).
+template<typename FieldType, size_t INLINE_VARIABLES=8>
+struct RuntimePolynomialRing : public PolynomialRing<FieldType, RuntimeExponents<INLINE_VARIABLES>::VARIABLES>
+{
+   using Exponents = RuntimeExponents<INLINE_VARIABLES>;
+};
+
+// The exponents storage of a policy (DenseExponents unless PolyRing::Exponents is given).
+template<typename PolyRing, typename = void>
+struct ExponentsOf
+{
+   using type = DenseExponents<PolyRing::VARIABLES>;
+};
+
+template<typename PolyRing>
+struct ExponentsOf<PolyRing, std::void_t<typename PolyRing::Exponents>>
+{
+   using type = typename PolyRing::Exponents;
+};
+
+template<typename Exponents, typename = void>
+struct HasRuntimeVariables : std::false_type {};
+
+template<typename Exponents>
+struct HasRuntimeVariables<Exponents, std::void_t<decltype(Exponents::variables())>> : std::true_type {};
+
+// The number of variables of a ring (loops over the variables should stop there, rather than at VARIABLES).
+template<typename PolyRing>
+size_t variablesOf()
+{
+   using Exponents = typename ExponentsOf<PolyRing>::type;
+   if constexpr (HasRuntimeVariables<Exponents>::value) return Exponents::variables();
+   else return PolyRing::VARIABLES;
+}
+
 
 // ** class Monomial
 ////////////////////////////////////////////////////////////////////////////
@@ -39,6 +88,8 @@ template <typename PolyRing>
 class Monomial
 {
 public:
+   using Exponents = typename ExponentsOf<PolyRing>::type;
+
    Monomial();
    Monomial(std::array<unsigned int, PolyRing::VARIABLES> powers);
 
@@ -51,9 +102,16 @@ public:
    void set(size_t i, unsigned int v);
    unsigned int powersSum() const; // The sum of all the powers (used by some orderings)
 
+   void operator*=(Monomial<PolyRing> const& other);
+   void operator/=(Monomial<PolyRing> const& other); // Assumes other divides *this.
+
+   Exponents const& exponents() const;
+
+   template<typename Ring>
+   friend Monomial<Ring> LCM(Monomial<Ring> const &m1, Monomial<Ring> const &m2);
+
 private:
-   std::array<unsigned int, PolyRing::VARIABLES> m_powers;
-   unsigned int m_powers_sum;
+   Exponents m_exponents;
 };
 
 
@@ -62,6 +120,28 @@ template<typename PolyRing>
 Monomial<PolyRing> LCM(Monomial<PolyRing> const &m1, Monomial<PolyRing> const &m2);
 
 
+// Ordering keys
+/////////////////////////////////////////////////////////////////////////////
+
+// An integer encoding of a monomial (32 bits per slot, two slots per word), such that
+// comparing two keys as arrays of unsigned words agrees with the ordering.
+// An ordering may opt in by providing:
+//    template<typename PolyRing> static auto sortKey(Monomial<PolyRing> const &m);
+// Orderings without sortKey are always compared through lessThen.
+template<size_t SLOTS>
+using OrderingKey = std::array<uint64_t, (SLOTS+1)/2>;
+
+template<size_t SLOTS, typename SlotFunc>
+OrderingKey<SLOTS> makeOrderingKey(SlotFunc&& slot);
+
+template<typename MonomialOrdering, typename PolyRing, typename = void>
+struct HasOrderingKey : std::false_type {};
+
+template<typename MonomialOrdering, typename PolyRing>
+struct HasOrderingKey<MonomialOrdering, PolyRing,
+                      std::void_t<decltype(MonomialOrdering::sortKey(std::declval<Monomial<PolyRing> const&>()))>> : std::true_type {};
+
+
 // Monomial ordering policies
 /////////////////////////////////////////////////////////////////////////////
 
@@ -71,9 +151,14 @@ struct LexOrder
    template<typename PolyRing>
    static bool lessThen(Monomial<PolyRing> const &m1, Monomial<PolyRing> const &m2)
    {
-      for (size_t i = 0; i < PolyRing::VARIABLES; ++i)
-         if (m1[i] != m2[i]) return m1[i] < m2[i];
-      return false;
+      return m1.exponents().lexLess(m2.exponents());
+   }
+
+   // <x1, x2, ..., xn>
+   template<typename PolyRing>
+   static OrderingKey<PolyRing::VARIABLES> sortKey(Monomial<PolyRing> const &m)
+   {
+      return makeOrderingKey<PolyRing::VARIABLES>([&m](size_t i) {return m[i];});
    }
 };
 
@@ -83,9 +168,14 @@ struct GrlexOrder
    template<typename PolyRing>
    static bool lessThen(Monomial<PolyRing> const &m1, Monomial<PolyRing> const &m2)
    {
-      if (m2.powersSum() != m1.powersSum())
-         return (m2.powersSum() > m1.powersSum());
-      return LexOrder::lessThen(m1, m2);
+      return m1.exponents().grlexLess(m2.exponents());
+   }
+
+   // <degree, x1, ..., x(n-1)> (xn is determined by the rest).
+   template<typename PolyRing>
+   static OrderingKey<PolyRing::VARIABLES> sortKey(Monomial<PolyRing> const &m)
+   {
+      return makeOrderingKey<PolyRing::VARIABLES>([&m](size_t i) {return (i == 0) ? m.powersSum() : m[i-1];});
    }
 };
 
@@ -96,14 +186,31 @@ struct GrevlexOrder
    template<typename PolyRing>
    static bool lessThen(Monomial<PolyRing> const &m1, Monomial<PolyRing> const &m2)
    {
-      if (m2.powersSum() != m1.powersSum())
-         return (m2.powersSum() > m1.powersSum());
-      for (int i = PolyRing::VARIABLES-1; i >= 0; --i)
-         if (m1[i] != m2[i]) return m1[i] > m2[i];
-      return false;
+      return m1.exponents().grevlexLess(m2.exponents());
+   }
+
+   // <degree, ~xn, ..., ~x2> (x1 is determined by the rest).
+   template<typename PolyRing>
+   static OrderingKey<PolyRing::VARIABLES> sortKey(Monomial<PolyRing> const &m)
+   {
+      return makeOrderingKey<PolyRing::VARIABLES>([&m](size_t i) {return (i == 0) ? m.powersSum() : ~m[PolyRing::VARIABLES-i];});
    }
 };
 
+// The ordering of the ring's context (for exponents sized at runtime, e.g. RuntimePolynomialRing).
+struct RuntimeOrder
+{
+   template<typename PolyRing>
+   static bool lessThen(Monomial<PolyRing> const &m1, Monomial<PolyRing> const &m2)
+   {
+      switch (Monomial<PolyRing>::Exponents::context().ordering)
+      {
+         case OrderingId::Grlex: return m1.exponents().grlexLess(m2.exponents());
+         case OrderingId::Grevlex: return m1.exponents().grevlexLess(m2.exponents());
+         default: return m1.exponents().lexLess(m2.exponents());
+      }
+   }
+};
 
 
 
@@ -111,18 +218,16 @@ struct GrevlexOrder
 /////////////////////////////////////////////////////////////////////////////
 template <typename PolyRing>
 Monomial<PolyRing>::Monomial()
-   : m_powers_sum(0)
 {
-   std::fill(m_powers.begin(), m_powers.end(), 0);
 }
 
 
 template <typename PolyRing>
 Monomial<PolyRing>::Monomial(std::array<unsigned int, PolyRing::VARIABLES> powers)
-   : m_powers(powers), m_powers_sum(0)
 {
    assert(powers.size() == PolyRing::VARIABLES);
-   for (auto c: m_powers) m_powers_sum += c;
+   for (size_t i = 0; i < PolyRing::VARIABLES; ++i)
+      m_exponents.set(i, powers[i]);
 }
 
 
@@ -130,9 +235,9 @@ template <typename PolyRing>
 std::string Monomial<PolyRing>::toString() const
 {
    std::stringstream str;
-   str << "<" << m_powers[0];
-   for (size_t i = 1; i < PolyRing::VARIABLES; ++i)         
-      str << "," << m_powers[i];
+   str << "<" << (*this)[0];
+   for (size_t i = 1; i < variablesOf<PolyRing>(); ++i)
+      str << "," << (*this)[i];
    str << ">";
    return str.str();
 }
@@ -140,9 +245,7 @@ std::string Monomial<PolyRing>::toString() const
 template <typename PolyRing>
 bool Monomial<PolyRing>::operator==(Monomial<PolyRing> const& other) const
 {
-   for (size_t i = 0; i < PolyRing::VARIABLES; ++i)
-      if (m_powers[i] != other[i]) return false;
-   return true;
+   return m_exponents == other.m_exponents;
 }
 
 template <typename PolyRing>
@@ -154,31 +257,59 @@ bool Monomial<PolyRing>::operator!=(Monomial<PolyRing> const& other) const
 template <typename PolyRing>
 unsigned int Monomial<PolyRing>::operator[](size_t i) const
 {
-   return m_powers[i];
+   return m_exponents.get(i);
 }
 
 template <typename PolyRing>
 void Monomial<PolyRing>::set(size_t i, unsigned int v)
 {
-   m_powers_sum -= m_powers[i];
-   m_powers_sum += v;
-   m_powers[i] = v;
+   m_exponents.set(i, v);
 }
 
 template <typename PolyRing>
 unsigned int Monomial<PolyRing>::powersSum() const
 {
-   return m_powers_sum;
+   return m_exponents.degree();
+}
+
+template <typename PolyRing>
+void Monomial<PolyRing>::operator*=(Monomial<PolyRing> const& other)
+{
+   m_exponents.multiply(other.m_exponents);
+}
+
+template <typename PolyRing>
+void Monomial<PolyRing>::operator/=(Monomial<PolyRing> const& other)
+{
+   m_exponents.divide(other.m_exponents);
+}
+
+template <typename PolyRing>
+typename Monomial<PolyRing>::Exponents const& Monomial<PolyRing>::exponents() const
+{
+   return m_exponents;
 }
 
 template<typename PolyRing>
 Monomial<PolyRing> LCM(Monomial<PolyRing> const &m1, Monomial<PolyRing> const &m2)
 {
-   Monomial<PolyRing> res;
-   for (size_t i = 0; i < PolyRing::VARIABLES; ++i)
-      res.set(i, std::max(m1[i], m2[i]));
+   Monomial<PolyRing> res(m1);
+   res.m_exponents.lcm(m2.m_exponents);
    return res;
 }
 
 
+// Ordering keys - implementation
+/////////////////////////////////////////////////////////////////////////////
+template<size_t SLOTS, typename SlotFunc>
+OrderingKey<SLOTS> makeOrderingKey(SlotFunc&& slot)
+{
+   OrderingKey<SLOTS> key;
+   key.fill(0);
+   for (size_t i = 0; i < SLOTS; ++i)
+      key[i/2] |= uint64_t(uint32_t(slot(i))) << ((i%2 == 0) ? 32 : 0);
+   return key;
+}
+
+
 #endif
@@ -0,0 +1,166 @@
+// parallel.h
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// ThreadPool - a fixed set of worker threads, which run batches of independent tasks.
+// Every worker has a deque of its own. The tasks of a batch are dealt to the deques in contiguous
+// blocks, a worker takes tasks from the back of its own deque, and once it runs out it steals from
+// the front of the others' (so uneven tasks are balanced, and neighbouring tasks mostly run on the
+// same thread).
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef parallel_H__
+#define parallel_H__
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+
+// ** class ThreadPool
+////////////////////////////////////////////////////////////////////////////
+class ThreadPool
+{
+public:
+   // A pool of no threads runs the tasks on the calling thread.
+   explicit ThreadPool(size_t threads = std::max(1u, std::thread::hardware_concurrency()));
+   ~ThreadPool();
+
+   ThreadPool(ThreadPool const&) = delete;
+   ThreadPool& operator=(ThreadPool const&) = delete;
+
+   size_t threads() const;
+
+   // Runs task(0), task(1), ..., task(count-1), and returns once all of them are done. A pool runs
+   // one batch at a time (run is not called concurrently, nor from a task).
+   template<typename Task>
+   void run(size_t count, Task&& task);
+
+private:
+   struct Worker
+   {
+      std::mutex mutex;
+      std::deque<std::function<void()>> tasks;
+   };
+
+   void work(size_t id);
+   bool take(size_t id, std::function<void()> &task); // From the back of its own deque, or stolen.
+
+private:
+   std::vector<std::unique_ptr<Worker>> m_workers;
+   std::vector<std::thread> m_threads;
+   std::mutex m_mutex;
+   std::condition_variable m_wake;
+   std::condition_variable m_done;
+   size_t m_queued;     // Tasks in the deques, which no worker has claimed yet.
+   size_t m_unfinished; // Tasks of the current batch which are not done.
+   bool m_stop;
+};
+
+
+
+// ThreadPool - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+inline ThreadPool::ThreadPool(size_t threads)
+   : m_queued(0), m_unfinished(0), m_stop(false)
+{
+   for (size_t i = 0; i < threads; ++i)
+      m_workers.push_back(std::make_unique<Worker>());
+   for (size_t i = 0; i < threads; ++i)
+      m_threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+inline ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+   }
+   m_wake.notify_all();
+   for (auto &thread: m_threads)
+      thread.join();
+}
+
+inline size_t ThreadPool::threads() const
+{
+   return m_threads.size();
+}
+
+template<typename Task>
+void ThreadPool::run(size_t count, Task&& task)
+{
+   if (count == 0) return;
+   if (m_threads.empty())
+   {
+      for (size_t i = 0; i < count; ++i)
+         task(i);
+      return;
+   }
+
+   const size_t n = m_workers.size();
+   for (size_t w = 0; w < n; ++w)
+   {
+      std::lock_guard<std::mutex> lock(m_workers[w]->mutex);
+      // The block is pushed in reverse, so its owner (which takes from the back) runs it in order.
+      for (size_t i = (w+1)*count/n; i-- > w*count/n;)
+         m_workers[w]->tasks.push_back([&task, i] {task(i);});
+   }
+
+   std::unique_lock<std::mutex> lock(m_mutex);
+   m_queued += count;
+   m_unfinished += count;
+   m_wake.notify_all();
+   m_done.wait(lock, [this] {return m_unfinished == 0;});
+}
+
+inline bool ThreadPool::take(size_t id, std::function<void()> &task)
+{
+   const size_t n = m_workers.size();
+   for (size_t k = 0; k < n; ++k)
+   {
+      Worker &worker = *m_workers[(id+k)%n];
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      if (worker.tasks.empty()) continue;
+      if (k == 0)
+      {
+         task = std::move(worker.tasks.back());
+         worker.tasks.pop_back();
+      }
+      else
+      {
+         task = std::move(worker.tasks.front());
+         worker.tasks.pop_front();
+      }
+      return true;
+   }
+   return false;
+}
+
+inline void ThreadPool::work(size_t id)
+{
+   while (true)
+   {
+      {
+         std::unique_lock<std::mutex> lock(m_mutex);
+         m_wake.wait(lock, [this] {return m_stop || (m_queued > 0);});
+         if (m_queued == 0) return; // Stopped.
+         --m_queued; // Claims a task, which is in one of the deques.
+      }
+
+      std::function<void()> task;
+      while (!take(id, task)) {}
+      task();
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_unfinished == 0) m_done.notify_all();
+   }
+}
+
+
+#endif
@@ -2,7 +2,11 @@
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 // (1) class Term<PolyRing> is a  polynomial term (coefficient from the field + a monomial).
-// (2) class Polynomial<PolyRing, MonomialOrdering> is an ordered sequence of terms.
+// (2) class Polynomial<PolyRing, MonomialOrdering> is an ordered sequence of terms. The terms are
+//     stored as a structure of arrays (an array of coefficients and an array of monomials), so
+//     scaling by a coefficient or shifting by a monomial is a tight loop over a single array.
+//     The arrays are allocated from the memory resource that is current when the polynomial is
+//     created or copied (see arena.h).
 // Methods:
 //   * LC:polymonial-->coefficient             : Leading coefficient.
 //   * LM:polymonial-->monomial                : Leading monomial.
@@ -11,6 +15,9 @@
 //   * operator* (term, polynomial)            : Multiplication.
 //   * operator* (polynomial, term)            : Multiplication.
 //   * operator* (polynomial, polynomial)      : Multiplication.
+//   * multiplyHeap (polynomial, polynomial)   : Multiplication (heap merge of the term products).
+//   * multiplyChunked (polynomial, polynomial): Multiplication (for very unbalanced operands).
+//   * multiplyParallel (polynomial, polynomial): Multiplication (by a thread pool, for large products).
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 
@@ -18,13 +25,21 @@
 #ifndef polynomials_H__
 #define polynomials_H__
 
+#include <queue>
 #include <vector>
 #include <string>
 #include <sstream>
+#include <array>
+#include <numeric>
+#include <cstdint>
+#include <utility>
 #include <algorithm>
+#include <type_traits>
 #include <initializer_list>
 
 #include "monomials.h"
+#include "parallel.h"
+#include "arena.h"
 
 
 // Terms
@@ -60,6 +75,50 @@ private:
 template<typename PolyRing>
 Term<PolyRing> operator*(typename PolyRing::Coefficient, Term<PolyRing> term);
 
+// Accumulates a sum of products of coefficients (used by the multiplication and division loops).
+// A coefficient type may delay the reduction of the sum by providing a nested Accumulator class,
+// with add(a), addProduct(a, b) and value().
+template<typename Coefficient>
+class PlainAccumulator
+{
+public:
+   void add(Coefficient const &a) {m_sum += a;}
+   void addProduct(Coefficient const &a, Coefficient const &b) {m_sum += a*b;}
+   Coefficient value() const {return m_sum;}
+
+private:
+   Coefficient m_sum = 0;
+};
+
+template<typename Coefficient, typename = void>
+struct AccumulatorOf
+{
+   using type = PlainAccumulator<Coefficient>;
+};
+
+template<typename Coefficient>
+struct AccumulatorOf<Coefficient, std::void_t<typename Coefficient::Accumulator>>
+{
+   using type = typename Coefficient::Accumulator;
+};
+
+// Coefficients with a notion of content (e.g. Rational) provide: static Coefficient gcd(a, b).
+template<typename Coefficient, typename = void>
+struct HasContent : std::false_type {};
+
+template<typename Coefficient>
+struct HasContent<Coefficient, std::void_t<decltype(Coefficient::gcd(std::declval<Coefficient>(), std::declval<Coefficient>()))>> : std::true_type {};
+
+// The permutation which sorts count monomials (monomial(i) is the i-th of them) in a descending order
+// (w.r.t MonomialOrdering). When the ordering provides a sortKey, the keys are computed once per
+// monomial and the sort compares integers only.
+template<typename MonomialOrdering, typename PolyRing, typename MonomialAt>
+std::vector<size_t> descendingOrder(size_t count, MonomialAt&& monomial);
+
+// Sorts terms in a descending order (w.r.t MonomialOrdering).
+template<typename MonomialOrdering, typename PolyRing>
+void sortTerms(std::vector<Term<PolyRing>> &terms);
+
 
 // Polynomials
 ////////////////////////////////////////////////////////////////////////////
@@ -69,37 +128,65 @@ template<typename PolyRing, typename MonomialOrdering>
 class Polynomial
 {
 public:
+   typedef PolyRing Ring;
+   typedef MonomialOrdering Ordering;
    typedef Term<PolyRing> TermType;
 
    Polynomial(size_t terms_preallocation=10);
    Polynomial(std::initializer_list<Term<PolyRing>> terms);
 
+   // A copy is allocated from the current resource (a moved polynomial keeps its own).
+   Polynomial(Polynomial<PolyRing, MonomialOrdering> const &other);
+   Polynomial(Polynomial<PolyRing, MonomialOrdering> &&other) = default;
+   Polynomial<PolyRing, MonomialOrdering>& operator=(Polynomial<PolyRing, MonomialOrdering> const &other) = default;
+   Polynomial<PolyRing, MonomialOrdering>& operator=(Polynomial<PolyRing, MonomialOrdering> &&other) = default;
+
+   // Builds a polynomial from terms which are expected in a descending order. The order is validated by a
+   // single pass, and only terms that are out of order (or repeated, or zero) are sorted and collected.
+   static Polynomial<PolyRing, MonomialOrdering> fromSortedTerms(std::vector<TermType> const &terms);
+   // Same, for count terms given by coefficient(i) and monomial(i) (e.g. read in bulk from arrays the caller
+   // owns), without a vector of terms in between.
+   template<typename CoefficientAt, typename MonomialAt>
+   static Polynomial<PolyRing, MonomialOrdering> fromTerms(size_t count, CoefficientAt&& coefficient, MonomialAt&& monomial);
+
    std::string toString() const;
 
    bool operator==(Polynomial<PolyRing, MonomialOrdering> const &other) const;
    bool operator!=(Polynomial<PolyRing, MonomialOrdering> const &other) const;
 
    void operator+=(TermType term);
-   void operator+=(Polynomial<PolyRing, MonomialOrdering> polynomial);
+   void operator+=(Polynomial<PolyRing, MonomialOrdering> const &polynomial);
    void operator-=(TermType term);
-   void operator-=(Polynomial<PolyRing, MonomialOrdering> polynomial);
-   void operator*=(typename PolyRing::Coefficient factor);
-   void operator*=(TermType const &m);
+   void operator-=(Polynomial<PolyRing, MonomialOrdering> const &polynomial);
+   void operator*=(typename PolyRing::Coefficient factor); // Keeps the order of the terms (never sorts).
+   void operator*=(TermType const &m);                     // Same.
  
    size_t terms() const;
-   TermType const& operator[](size_t i) const;
+   TermType operator[](size_t i) const;
    typename PolyRing::Coefficient const& getCoeff(size_t i) const;
    Monomial<PolyRing> const& getMonomial(size_t i) const;
+
+   // The arrays of the coefficients and of the monomials (terms() of each, in the order of the terms).
+   typename PolyRing::Coefficient const* coefficients() const;
+   Monomial<PolyRing> const* monomials() const;
  
    void normalize(); // Factors so the leading coefficient is 1.
+   void makePrimitive(); // Divides by the content (the gcd of the coefficients), or normalizes if there is none.
+
+   // Used by algorithms which produce terms in a descending order (assumes term is smaller than all
+   // the terms of *this, and that its coefficient is not zero).
+   void appendTerm(TermType term);
 
 private:
    void collectTerms(); 
    void removeZeros(); // Removes terms whose coefficient is 0.
-   void sortSelf();
+   bool isCanonical() const; // The terms are in a strictly descending order, and none is zero.
+   void sortSelf(); // Puts the terms in a canonical form (unless they already are).
+   void merge(Polynomial<PolyRing, MonomialOrdering> const &other, typename PolyRing::Coefficient factor); // *this += factor*other
    
 private:
-   std::vector<TermType> m_terms;
+   std::pmr::vector<typename PolyRing::Coefficient> m_coeffs;
+   std::pmr::vector<Monomial<PolyRing>> m_monomials;
 };
 
 // Leading coefficient
@@ -112,7 +199,7 @@ Monomial<PolyRing> const& LM(Polynomial<PolyRing, MonomialOrdering> const &p);
 
 // Leading term
 template<typename PolynomialType>
-typename PolynomialType::TermType const& LT(PolynomialType const &p);
+typename PolynomialType::TermType LT(PolynomialType const &p);
 
 
 template<typename PolyRing, typename MonomialOrdering>
@@ -127,6 +214,32 @@ Polynomial<PolyRing, MonomialOrdering> operator*(typename PolyRing::Coefficient
 template<typename PolyRing, typename MonomialOrdering>
 Polynomial<PolyRing, MonomialOrdering> operator*(Polynomial<PolyRing, MonomialOrdering> const &p1, Polynomial<PolyRing, MonomialOrdering> const &p2);
 
+// Multiplies p1 by the terms [begin2, end2) of p2. The products are merged through a heap (holding at
+// most one product per term of p1), so the terms are produced in a descending order and never sorted.
+template<typename PolyRing, typename MonomialOrdering>
+Polynomial<PolyRing, MonomialOrdering> multiplyHeap(Polynomial<PolyRing, MonomialOrdering> const &p1, Polynomial<PolyRing, MonomialOrdering> const &p2,
+                                                    size_t begin2, size_t end2);
+
+// Splits the larger operand into chunks of chunk_terms terms, multiplies each of them by the smaller
+// operand (multiplyHeap), and sums the partial products pairwise.
+template<typename PolyRing, typename MonomialOrdering>
+Polynomial<PolyRing, MonomialOrdering> multiplyChunked(Polynomial<PolyRing, MonomialOrdering> const &p1, Polynomial<PolyRing, MonomialOrdering> const &p2,
+                                                       size_t chunk_terms);
+
+// Multiplies p1 by the terms [rows[i].first, rows[i].second) of p2, for every term i of p1 (a heap merge,
+// like multiplyHeap, which starts with all the rows in the heap).
+template<typename PolyRing, typename MonomialOrdering>
+Polynomial<PolyRing, MonomialOrdering> multiplyRows(Polynomial<PolyRing, MonomialOrdering> const &p1, Polynomial<PolyRing, MonomialOrdering> const &p2,
+                                                    std::vector<std::pair<size_t, size_t>> const &rows);
+
+// Multiplication by the threads of a pool. The monomials of the product are split into bands (by splitters
+// sampled from the term products), and the products of every band are merged on their own (multiplyRows),
+// so the product is the concatenation of the bands. Products of fewer than serial_products term products
+// are multiplied serially (operator*).
+template<typename PolyRing, typename MonomialOrdering>
+Polynomial<PolyRing, MonomialOrdering> multiplyParallel(Polynomial<PolyRing, MonomialOrdering> const &p1, Polynomial<PolyRing, MonomialOrdering> const &p2,
+                                                        ThreadPool &pool, size_t serial_products = (1 << 16));
+
 
 // Terms - Implementation
 ////////////////////////////////////////////////////////////////////////////
@@ -189,8 +302,7 @@ void Term<PolyRing>::operator*=(typename PolyRing::Coefficient factor)
 template<typename PolyRing>
 void Term<PolyRing>::operator*=(Term<PolyRing> const &other)
 {
-   for (size_t i = 0; i < PolyRing::VARIABLES; ++i)
-      m_monomial.set(i, m_monomial[i]+other.getMonomial()[i]);
+   m_monomial *= other.getMonomial();
    m_coeff *= other.getCoeff();
 }
 
@@ -201,6 +313,101 @@ Term<PolyRing> operator*(typename PolyRing::Coefficient factor, Term<PolyRing> t
    return term;
 }
 
+// Sorts (key, index) pairs in a descending order of their keys, in 8-bit digits (LSD radix sort).
+inline void radixSortDescending(std::vector<std::pair<uint64_t, uint32_t>> &keys, unsigned int bits)
+{
+   std::vector<std::pair<uint64_t, uint32_t>> buffer(keys.size());
+   for (unsigned int shift = 0; shift < bits; shift += 8)
+   {
+      std::array<size_t, 257> offsets {};
+      for (auto const &k: keys)
+         ++offsets[255-((k.first >> shift) & 0xff)+1];
+      for (size_t d = 1; d < offsets.size(); ++d)
+         offsets[d] += offsets[d-1];
+      for (auto const &k: keys)
+         buffer[offsets[255-((k.first >> shift) & 0xff)]++] = k;
+      keys.swap(buffer);
+   }
+}
+
+template<typename MonomialOrdering, typename PolyRing, typename MonomialAt>
+std::vector<size_t> descendingOrder(size_t count, MonomialAt&& monomial)
+{
+   std::vector<size_t> order(count);
+   if constexpr (HasOrderingKey<MonomialOrdering, PolyRing>::value)
+   {
+      // Building the keys does not pay off for short sequences.
+      if (count >= 32)
+      {
+         using Key = decltype(MonomialOrdering::sortKey(std::declval<Monomial<PolyRing> const&>()));
+         const size_t SLOTS = 2*std::tuple_size<Key>::value;
+         auto slot = [](Key const &key, size_t i) {return uint32_t(key[i/2] >> ((i%2 == 0) ? 32 : 0));};
+
+         std::vector<Key> keys;
+         keys.reserve(count);
+         std::array<uint32_t, SLOTS> low, high;
+         low.fill(~uint32_t(0));
+         high.fill(0);
+         for (size_t t = 0; t < count; ++t)
+         {
+            keys.push_back(MonomialOrdering::sortKey(monomial(t)));
+            for (size_t i = 0; i < SLOTS; ++i)
+            {
+               low[i] = std::min(low[i], slot(keys.back(), i));
+               high[i] = std::max(high[i], slot(keys.back(), i));
+            }
+         }
+
+         // Typically, the slots span a small range, so the keys can be compressed into a single word.
+         std::array<unsigned int, SLOTS> widths;
+         unsigned int total_width = 0;
+         for (size_t i = 0; i < SLOTS; ++i)
+         {
+            widths[i] = 0;
+            while ((widths[i] < 32) && ((uint64_t(high[i]-low[i]) >> widths[i]) != 0)) ++widths[i];
+            total_width += widths[i];
+         }
+
+         if (total_width <= 64)
+         {
+            std::vector<std::pair<uint64_t, uint32_t>> compressed(count);
+            for (size_t t = 0; t < count; ++t)
+            {
+               uint64_t word = 0;
+               for (size_t i = 0; i < SLOTS; ++i)
+                  if (widths[i] != 0) word = (word << widths[i]) | (slot(keys[t], i)-low[i]);
+               compressed[t] = std::make_pair(word, uint32_t(t));
+            }
+            radixSortDescending(compressed, total_width);
+            for (size_t t = 0; t < count; ++t)
+               order[t] = compressed[t].second;
+         }
+         else
+         {
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) {return keys[b] < keys[a];});
+         }
+         return order;
+      }
+   }
+   std::iota(order.begin(), order.end(), 0);
+   std::sort(order.begin(), order.end(), [&monomial](size_t a, size_t b) {return MonomialOrdering::lessThen(monomial(b), monomial(a));});
+   return order;
+}
+
+template<typename MonomialOrdering, typename PolyRing>
+void sortTerms(std::vector<Term<PolyRing>> &terms)
+{
+   auto order = descendingOrder<MonomialOrdering, PolyRing>(terms.size(), [&terms](size_t t) -> Monomial<PolyRing> const& {
+      return terms[t].getMonomial();
+   });
+   std::vector<Term<PolyRing>> sorted;
+   sorted.reserve(terms.capacity());
+   for (size_t t: order)
+      sorted.push_back(std::move(terms[t]));
+   terms.swap(sorted);
+}
+
 
 
 // Polynomials - Implementation
@@ -208,17 +415,50 @@ Term<PolyRing> operator*(typename PolyRing::Coefficient factor, Term<PolyRing> t
 
 template<typename PolyRing, typename MonomialOrdering>
 Polynomial<PolyRing, MonomialOrdering>::Polynomial(size_t terms_preallocation) 
+   : m_coeffs(currentPolynomialResource()), m_monomials(currentPolynomialResource())
 {
-   m_terms.reserve(terms_preallocation);
+   m_coeffs.reserve(terms_preallocation);
+   m_monomials.reserve(terms_preallocation);
 }
 
 template<typename PolyRing, typename MonomialOrdering>
 Polynomial<PolyRing, MonomialOrdering>::Polynomial(std::initializer_list<Term<PolyRing>> terms)
-   : m_terms(terms)
+   : Polynomial(terms.size())
 {
+   for (auto const &t: terms)
+   {
+      m_coeffs.push_back(t.getCoeff());
+      m_monomials.push_back(t.getMonomial());
+   }
    sortSelf();
 }
 
+template<typename PolyRing, typename MonomialOrdering>
+Polynomial<PolyRing, MonomialOrdering>::Polynomial(Polynomial<PolyRing, MonomialOrdering> const &other)
+   : m_coeffs(other.m_coeffs, currentPolynomialResource()), m_monomials(other.m_monomials, currentPolynomialResource())
+{
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+Polynomial<PolyRing, MonomialOrdering> Polynomial<PolyRing, MonomialOrdering>::fromSortedTerms(std::vector<TermType> const &terms)
+{
+   return fromTerms(terms.size(), [&terms](size_t i) {return terms[i].getCoeff();}, [&terms](size_t i) {return terms[i].getMonomial();});
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+template<typename CoefficientAt, typename MonomialAt>
+Polynomial<PolyRing, MonomialOrdering> Polynomial<PolyRing, MonomialOrdering>::fromTerms(size_t count, CoefficientAt&& coefficient, MonomialAt&& monomial)
+{
+   Polynomial<PolyRing, MonomialOrdering> p(count);
+   for (size_t i = 0; i < count; ++i)
+   {
+      p.m_coeffs.push_back(coefficient(i));
+      p.m_monomials.push_back(monomial(i));
+   }
+   p.sortSelf();
+   return p;
+}
+
 template<typename PolyRing, typename MonomialOrdering>
 std::string Polynomial<PolyRing, MonomialOrdering>::toString() const
 {
@@ -234,10 +474,7 @@ std::string Polynomial<PolyRing, MonomialOrdering>::toString() const
 template<typename PolyRing, typename MonomialOrdering>
 bool Polynomial<PolyRing, MonomialOrdering>::operator==(Polynomial<PolyRing, MonomialOrdering> const &other) const
 {
-   if (terms() != other.terms()) return false;
-   for (size_t i = 0; i < terms(); ++i)
-      if (getMonomial(i) != other.getMonomial(i)) return false;
-   return true;
+   return (m_monomials == other.m_monomials);
 }
 
 template<typename PolyRing, typename MonomialOrdering>
@@ -249,16 +486,29 @@ bool Polynomial<PolyRing, MonomialOrdering>::operator!=(Polynomial<PolyRing, Mon
 template<typename PolyRing, typename MonomialOrdering>
 void Polynomial<PolyRing, MonomialOrdering>::operator+=(TermType term)
 {
-   m_terms.push_back(term);
-   sortSelf();
+   auto it = std::lower_bound(m_monomials.begin(), m_monomials.end(), term.getMonomial(),
+                              [](Monomial<PolyRing> const &m1, Monomial<PolyRing> const &m2) {return MonomialOrdering::lessThen(m2, m1);});
+   size_t i = it-m_monomials.begin();
+   if ((it != m_monomials.end()) && (*it == term.getMonomial()))
+   {
+      m_coeffs[i] += term.getCoeff();
+      if (PolyRing::isZero(m_coeffs[i]))
+      {
+         m_coeffs.erase(m_coeffs.begin()+i);
+         m_monomials.erase(it);
+      }
+   }
+   else if (!PolyRing::isZero(term.getCoeff()))
+   {
+      m_coeffs.insert(m_coeffs.begin()+i, term.getCoeff());
+      m_monomials.insert(it, std::move(term.getMonomial()));
+   }
 }
 
 template<typename PolyRing, typename MonomialOrdering>
-void Polynomial<PolyRing, MonomialOrdering>::operator+=(Polynomial<PolyRing, MonomialOrdering> polynomial)
+void Polynomial<PolyRing, MonomialOrdering>::operator+=(Polynomial<PolyRing, MonomialOrdering> const &polynomial)
 {
-   for (size_t i = 0; i < polynomial.terms(); ++i)
-      m_terms.push_back(polynomial[i]);
-   sortSelf();
+   merge(polynomial, 1);
 }
 
 template<typename PolyRing, typename MonomialOrdering>
@@ -268,103 +518,220 @@ void Polynomial<PolyRing, MonomialOrdering>::operator-=(TermType term)
 }
 
 template<typename PolyRing, typename MonomialOrdering>
-void Polynomial<PolyRing, MonomialOrdering>::operator-=(Polynomial<PolyRing, MonomialOrdering> polynomial)
+void Polynomial<PolyRing, MonomialOrdering>::operator-=(Polynomial<PolyRing, MonomialOrdering> const &polynomial)
 {
-   for (size_t i = 0; i < polynomial.terms(); ++i)
-      m_terms.push_back(-1*polynomial[i]);
-   sortSelf();
+   merge(polynomial, -1);
 }
 
 template<typename PolyRing, typename MonomialOrdering>
 void Polynomial<PolyRing, MonomialOrdering>::operator*=(typename PolyRing::Coefficient factor)
 {
-   for (auto &t: m_terms) t *= factor;
-   sortSelf();
+   // Scaling keeps the order of the monomials, and only the coefficients that vanish (e.g. underflow) are removed.
+   for (auto &c: m_coeffs) c *= factor;
+   removeZeros();
 }
 
 template<typename PolyRing, typename MonomialOrdering>
 void Polynomial<PolyRing, MonomialOrdering>::operator*=(TermType const &m)
 {
-   for (auto &t: m_terms) t *= m;
-   sortSelf();
+   // Monomial orderings are compatible with multiplication (a < b implies a*m < b*m), so the order is kept.
+   for (auto &c: m_coeffs) c *= m.getCoeff();
+   for (auto &monomial: m_monomials) monomial *= m.getMonomial();
+   removeZeros();
 }
 
 template<typename PolyRing, typename MonomialOrdering>
 size_t Polynomial<PolyRing, MonomialOrdering>::terms() const
 {
-   return m_terms.size();
+   return m_monomials.size();
 }
 
 template<typename PolyRing, typename MonomialOrdering>
-typename Polynomial<PolyRing, MonomialOrdering>::TermType const& Polynomial<PolyRing, MonomialOrdering>::operator[](size_t i) const
+typename Polynomial<PolyRing, MonomialOrdering>::TermType Polynomial<PolyRing, MonomialOrdering>::operator[](size_t i) const
 {
-   return m_terms[i];
+   return TermType(m_coeffs[i], m_monomials[i]);
 }
 
 template<typename PolyRing, typename MonomialOrdering>
 typename PolyRing::Coefficient const& Polynomial<PolyRing, MonomialOrdering>::getCoeff(size_t i) const
 {
-   return m_terms[i].getCoeff();
+   return m_coeffs[i];
 }
 
 template<typename PolyRing, typename MonomialOrdering>
 Monomial<PolyRing> const& Polynomial<PolyRing, MonomialOrdering>::getMonomial(size_t i) const
 {
-   return m_terms[i].getMonomial();
+   return m_monomials[i];
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+typename PolyRing::Coefficient const* Polynomial<PolyRing, MonomialOrdering>::coefficients() const
+{
+   return m_coeffs.data();
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+Monomial<PolyRing> const* Polynomial<PolyRing, MonomialOrdering>::monomials() const
+{
+   return m_monomials.data();
 }
 
 template<typename PolyRing, typename MonomialOrdering>
 void Polynomial<PolyRing, MonomialOrdering>::normalize()
 {
-   auto factor = m_terms[0].getCoeff();
-   for (auto &t: m_terms)
-      t.getCoeff() /= factor;
+   // One inversion (the leading coefficient becomes exactly 1).
+   if (m_coeffs.empty()) return;
+   auto inverse = typename PolyRing::Coefficient(1)/m_coeffs[0];
+   m_coeffs[0] = 1;
+   for (auto it = m_coeffs.begin()+1; it != m_coeffs.end(); ++it)
+      *it *= inverse;
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+void Polynomial<PolyRing, MonomialOrdering>::makePrimitive()
+{
+   using Coefficient = typename PolyRing::Coefficient;
+   if constexpr (HasContent<Coefficient>::value)
+   {
+      if (m_coeffs.empty()) return;
+      Coefficient content = m_coeffs[0];
+      for (auto it = m_coeffs.begin()+1; it != m_coeffs.end(); ++it)
+         content = Coefficient::gcd(content, *it);
+      for (auto &c: m_coeffs)
+         c /= content;
+   }
+   else normalize();
 }
 
 template<typename PolyRing, typename MonomialOrdering>
 void Polynomial<PolyRing, MonomialOrdering>::collectTerms()
 {
    // Assumes *this is sorted.
-   auto prev = m_terms.begin();
-   auto it = m_terms.begin()+1;
-   while (it != m_terms.end())
+   if (m_monomials.empty()) return;
+   size_t prev = 0;
+   for (size_t i = 1; i < m_monomials.size(); ++i)
    {
-      if (it->getMonomial() == prev->getMonomial())
+      if (m_monomials[i] == m_monomials[prev])
+         m_coeffs[prev] += m_coeffs[i];
+      else if (++prev != i)
       {
-         prev->getCoeff() += it->getCoeff();
-         it = m_terms.erase(it);
-         prev = it-1;
+         m_coeffs[prev] = std::move(m_coeffs[i]);
+         m_monomials[prev] = std::move(m_monomials[i]);
       }
-      else
+   }
+   m_coeffs.resize(prev+1);
+   m_monomials.resize(prev+1);
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+void Polynomial<PolyRing, MonomialOrdering>::removeZeros()
+{
+   size_t kept = 0;
+   for (size_t i = 0; i < m_coeffs.size(); ++i)
+   {
+      if (PolyRing::isZero(m_coeffs[i])) continue;
+      if (kept != i)
       {
-        prev = it;
-         ++it;
+         m_coeffs[kept] = std::move(m_coeffs[i]);
+         m_monomials[kept] = std::move(m_monomials[i]);
       }
-  }
+      ++kept;
+   }
+   m_coeffs.resize(kept);
+   m_monomials.resize(kept);
 }
 
 template<typename PolyRing, typename MonomialOrdering>
-void Polynomial<PolyRing, MonomialOrdering>::removeZeros()
+bool Polynomial<PolyRing, MonomialOrdering>::isCanonical() const
 {
-   auto it = m_terms.begin();
-   while (it != m_terms.end())
+   for (size_t i = 0; i < terms(); ++i)
    {
-      if (PolyRing::isZero(it->getCoeff()))
-         it = m_terms.erase(it);
-      else ++it;
+      if (PolyRing::isZero(m_coeffs[i])) return false;
+      if ((i > 0) && !MonomialOrdering::lessThen(m_monomials[i], m_monomials[i-1])) return false;
    }
+   return true;
 }
 
 template<typename PolyRing, typename MonomialOrdering>
 void Polynomial<PolyRing, MonomialOrdering>::sortSelf()
 {
-   if (terms() == 0) return;
-   std::sort(m_terms.rbegin(), m_terms.rend(),
-             [](TermType const &m1, TermType const &m2) {return MonomialOrdering::lessThen(m1.getMonomial(), m2.getMonomial());});
+   if (isCanonical()) return;
+   auto order = descendingOrder<MonomialOrdering, PolyRing>(terms(), [this](size_t t) -> Monomial<PolyRing> const& {return m_monomials[t];});
+   std::pmr::vector<typename PolyRing::Coefficient> coeffs(m_coeffs.get_allocator());
+   std::pmr::vector<Monomial<PolyRing>> monomials(m_monomials.get_allocator());
+   coeffs.reserve(m_coeffs.capacity());
+   monomials.reserve(m_monomials.capacity());
+   for (size_t t: order)
+   {
+      coeffs.push_back(std::move(m_coeffs[t]));
+      monomials.push_back(std::move(m_monomials[t]));
+   }
+   m_coeffs.swap(coeffs);
+   m_monomials.swap(monomials);
    collectTerms();
    removeZeros();
 }
 
+template<typename PolyRing, typename MonomialOrdering>
+void Polynomial<PolyRing, MonomialOrdering>::merge(Polynomial<PolyRing, MonomialOrdering> const &other, typename PolyRing::Coefficient factor)
+{
+   // Both sequences are sorted, so a single pass produces the (sorted) sum.
+   std::pmr::vector<typename PolyRing::Coefficient> coeffs(m_coeffs.get_allocator());
+   std::pmr::vector<Monomial<PolyRing>> monomials(m_monomials.get_allocator());
+   coeffs.reserve(terms()+other.terms());
+   monomials.reserve(terms()+other.terms());
+
+   size_t i = 0, j = 0;
+   while ((i < terms()) && (j < other.terms()))
+   {
+      auto const &m1 = getMonomial(i);
+      auto const &m2 = other.getMonomial(j);
+      if (m1 == m2)
+      {
+         auto c = getCoeff(i) + factor*other.getCoeff(j);
+         if (!PolyRing::isZero(c))
+         {
+            coeffs.push_back(c);
+            monomials.push_back(m1);
+         }
+         ++i; ++j;
+      }
+      else if (MonomialOrdering::lessThen(m2, m1))
+      {
+         // A run of the terms of *this is copied array by array.
+         size_t run = i+1;
+         while ((run < terms()) && MonomialOrdering::lessThen(m2, getMonomial(run))) ++run;
+         coeffs.insert(coeffs.end(), std::make_move_iterator(m_coeffs.begin()+i), std::make_move_iterator(m_coeffs.begin()+run));
+         monomials.insert(monomials.end(), std::make_move_iterator(m_monomials.begin()+i), std::make_move_iterator(m_monomials.begin()+run));
+         i = run;
+      }
+      else
+      {
+         coeffs.push_back(factor*other.getCoeff(j));
+         monomials.push_back(m2);
+         ++j;
+      }
+   }
+   coeffs.insert(coeffs.end(), std::make_move_iterator(m_coeffs.begin()+i), std::make_move_iterator(m_coeffs.end()));
+   monomials.insert(monomials.end(), std::make_move_iterator(m_monomials.begin()+i), std::make_move_iterator(m_monomials.end()));
+   for (; j < other.terms(); ++j)
+   {
+      coeffs.push_back(factor*other.getCoeff(j));
+      monomials.push_back(other.getMonomial(j));
+   }
+
+   m_coeffs.swap(coeffs);
+   m_monomials.swap(monomials);
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+void Polynomial<PolyRing, MonomialOrdering>::appendTerm(TermType term)
+{
+   assert(m_monomials.empty() || MonomialOrdering::lessThen(term.getMonomial(), m_monomials.back()));
+   m_coeffs.push_back(term.getCoeff());
+   m_monomials.push_back(std::move(term.getMonomial()));
+}
+
 
 template<typename PolyRing, typename MonomialOrdering>
 typename PolyRing::Coefficient LC(Polynomial<PolyRing, MonomialOrdering> const &p)
@@ -380,7 +747,7 @@ Monomial<PolyRing> const& LM(Polynomial<PolyRing, MonomialOrdering> const &p)
 }
 
 template<typename PolynomialType>
-typename PolynomialType::TermType const& LT(PolynomialType const &p)
+typename PolynomialType::TermType LT(PolynomialType const &p)
 {
    return p[0];
 }
@@ -409,17 +776,216 @@ Polynomial<PolyRing, MonomialOrdering> operator*(typename PolyRing::Coefficient
 
 
 
-// Multiplication of 2 polynomials (direct).
+// Multiplication of 2 polynomials.
 template<typename PolyRing, typename MonomialOrdering>
 Polynomial<PolyRing, MonomialOrdering> operator*(Polynomial<PolyRing, MonomialOrdering> const &p1, Polynomial<PolyRing, MonomialOrdering> const &p2)
 {
-   Polynomial<PolyRing, MonomialOrdering> product;
-   for (size_t i = 0; i < p1.terms(); ++i) {
-         product += p2*p1[i];
+   // The heap holds a product per term of the first operand, so it should be the smaller one.
+   auto const &smaller = (p1.terms() <= p2.terms()) ? p1 : p2;
+   auto const &larger = (p1.terms() <= p2.terms()) ? p2 : p1;
+
+   const size_t CHUNK_RATIO = 64;
+   if (larger.terms() > CHUNK_RATIO*CHUNK_RATIO*std::max<size_t>(smaller.terms(), 1))
+      return multiplyChunked(smaller, larger, CHUNK_RATIO*CHUNK_RATIO*smaller.terms());
+   return multiplyHeap(smaller, larger, 0, larger.terms());
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+Polynomial<PolyRing, MonomialOrdering> multiplyHeap(Polynomial<PolyRing, MonomialOrdering> const &p1, Polynomial<PolyRing, MonomialOrdering> const &p2,
+                                                    size_t begin2, size_t end2)
+{
+   // A heap entry is the product p1[i]*p2[j]. Once it is popped, p1[i]*p2[j+1] is pushed, and when j is
+   // the first term, so is p1[i+1]*p2[begin2] (this is the next candidate for being the largest product).
+   struct Product
+   {
+      Monomial<PolyRing> monomial;
+      size_t i, j;
+   };
+   auto less = [](Product const &a, Product const &b) {return MonomialOrdering::lessThen(a.monomial, b.monomial);};
+   auto makeProduct = [&p1, &p2](size_t i, size_t j) {
+      Product product {p1.getMonomial(i), i, j};
+      product.monomial *= p2.getMonomial(j);
+      return product;
+   };
+
+   Polynomial<PolyRing, MonomialOrdering> product(std::min<size_t>(p1.terms()*(end2-begin2), 1 << 16));
+   if ((p1.terms() == 0) || (begin2 >= end2)) return product;
+
+   std::vector<Product> heap;
+   heap.reserve(p1.terms());
+   heap.push_back(makeProduct(0, begin2));
+
+   while (!heap.empty())
+   {
+      Monomial<PolyRing> current = heap.front().monomial;
+      typename AccumulatorOf<typename PolyRing::Coefficient>::type sum;
+      while (!heap.empty() && (heap.front().monomial == current))
+      {
+         std::pop_heap(heap.begin(), heap.end(), less);
+         Product popped = heap.back();
+         heap.pop_back();
+         sum.addProduct(p1.getCoeff(popped.i), p2.getCoeff(popped.j));
+
+         if (popped.j+1 < end2)
+         {
+            heap.push_back(makeProduct(popped.i, popped.j+1));
+            std::push_heap(heap.begin(), heap.end(), less);
+         }
+         if ((popped.j == begin2) && (popped.i+1 < p1.terms()))
+         {
+            heap.push_back(makeProduct(popped.i+1, begin2));
+            std::push_heap(heap.begin(), heap.end(), less);
+         }
+      }
+      auto coeff = sum.value();
+      if (!PolyRing::isZero(coeff))
+         product.appendTerm(Term<PolyRing>(coeff, std::move(current)));
    }
    return product;
 }
 
+template<typename PolyRing, typename MonomialOrdering>
+Polynomial<PolyRing, MonomialOrdering> multiplyChunked(Polynomial<PolyRing, MonomialOrdering> const &p1, Polynomial<PolyRing, MonomialOrdering> const &p2,
+                                                       size_t chunk_terms)
+{
+   auto const &smaller = (p1.terms() <= p2.terms()) ? p1 : p2;
+   auto const &larger = (p1.terms() <= p2.terms()) ? p2 : p1;
+   chunk_terms = std::max<size_t>(chunk_terms, 1);
+
+   std::vector<Polynomial<PolyRing, MonomialOrdering>> partials;
+   for (size_t begin = 0; begin < larger.terms(); begin += chunk_terms)
+      partials.push_back(multiplyHeap(smaller, larger, begin, std::min(begin+chunk_terms, larger.terms())));
+   if (partials.empty()) return Polynomial<PolyRing, MonomialOrdering>();
+
+   // Pairwise summation keeps every term from being merged more than log(#chunks) times.
+   for (size_t step = 1; step < partials.size(); step *= 2)
+      for (size_t i = 0; i+step < partials.size(); i += 2*step)
+         partials[i] += partials[i+step];
+   return partials[0];
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+Polynomial<PolyRing, MonomialOrdering> multiplyRows(Polynomial<PolyRing, MonomialOrdering> const &p1, Polynomial<PolyRing, MonomialOrdering> const &p2,
+                                                    std::vector<std::pair<size_t, size_t>> const &rows)
+{
+   // Unlike in multiplyHeap, the rows do not start at the same term of p2, so p1[i+1]*p2[rows[i+1].first]
+   // may be larger than p1[i]*p2[rows[i].first], and every row is in the heap from the start.
+   struct Product
+   {
+      Monomial<PolyRing> monomial;
+      size_t i, j;
+   };
+   auto less = [](Product const &a, Product const &b) {return MonomialOrdering::lessThen(a.monomial, b.monomial);};
+   auto makeProduct = [&p1, &p2](size_t i, size_t j) {
+      Product product {p1.getMonomial(i), i, j};
+      product.monomial *= p2.getMonomial(j);
+      return product;
+   };
+
+   std::vector<Product> heap;
+   size_t products = 0;
+   for (size_t i = 0; i < p1.terms(); ++i)
+   {
+      if (rows[i].first >= rows[i].second) continue;
+      heap.push_back(makeProduct(i, rows[i].first));
+      products += rows[i].second-rows[i].first;
+   }
+   std::make_heap(heap.begin(), heap.end(), less);
+
+   Polynomial<PolyRing, MonomialOrdering> product(std::min<size_t>(products, 1 << 16));
+   while (!heap.empty())
+   {
+      Monomial<PolyRing> current = heap.front().monomial;
+      typename AccumulatorOf<typename PolyRing::Coefficient>::type sum;
+      while (!heap.empty() && (heap.front().monomial == current))
+      {
+         std::pop_heap(heap.begin(), heap.end(), less);
+         Product popped = heap.back();
+         heap.pop_back();
+         sum.addProduct(p1.getCoeff(popped.i), p2.getCoeff(popped.j));
+
+         if (popped.j+1 < rows[popped.i].second)
+         {
+            heap.push_back(makeProduct(popped.i, popped.j+1));
+            std::push_heap(heap.begin(), heap.end(), less);
+         }
+      }
+      auto coeff = sum.value();
+      if (!PolyRing::isZero(coeff))
+         product.appendTerm(Term<PolyRing>(coeff, std::move(current)));
+   }
+   return product;
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+Polynomial<PolyRing, MonomialOrdering> multiplyParallel(Polynomial<PolyRing, MonomialOrdering> const &p1, Polynomial<PolyRing, MonomialOrdering> const &p2,
+                                                        ThreadPool &pool, size_t serial_products)
+{
+   auto const &smaller = (p1.terms() <= p2.terms()) ? p1 : p2;
+   auto const &larger = (p1.terms() <= p2.terms()) ? p2 : p1;
+   if ((pool.threads() < 2) || (smaller.terms() == 0) || (smaller.terms()*larger.terms() < serial_products))
+      return p1*p2;
+
+   // The splitters are quantiles of a grid of sampled products. There are a few bands per thread, so the
+   // pool can balance bands of uneven sizes.
+   const size_t GRID = 64;
+   const size_t bands = 4*pool.threads();
+   std::vector<Monomial<PolyRing>> samples;
+   for (size_t a = 0; a < std::min(GRID, smaller.terms()); ++a)
+   {
+      for (size_t b = 0; b < std::min(GRID, larger.terms()); ++b)
+      {
+         samples.push_back(smaller.getMonomial(a*smaller.terms()/std::min(GRID, smaller.terms())));
+         samples.back() *= larger.getMonomial(b*larger.terms()/std::min(GRID, larger.terms()));
+      }
+   }
+   std::sort(samples.begin(), samples.end(), [](Monomial<PolyRing> const &m1, Monomial<PolyRing> const &m2) {
+      return MonomialOrdering::lessThen(m2, m1);
+   });
+   std::vector<Monomial<PolyRing>> splitters;
+   for (size_t k = 1; k < bands; ++k)
+   {
+      auto const &splitter = samples[k*samples.size()/bands];
+      if (splitters.empty() || MonomialOrdering::lessThen(splitter, splitters.back()))
+         splitters.push_back(splitter);
+   }
+
+   // Band k holds the products m with splitters[k-1] >= m > splitters[k]. In every row the products
+   // descend, so a band is a range of the row, which starts at the count of its products above the splitter.
+   std::vector<std::vector<size_t>> bounds(splitters.size()+2, std::vector<size_t>(smaller.terms(), 0));
+   std::fill(bounds.back().begin(), bounds.back().end(), larger.terms());
+   pool.run(splitters.size(), [&](size_t k) {
+      for (size_t i = 0; i < smaller.terms(); ++i)
+      {
+         size_t low = 0, high = larger.terms();
+         while (low < high)
+         {
+            size_t middle = (low+high)/2;
+            Monomial<PolyRing> m(smaller.getMonomial(i));
+            m *= larger.getMonomial(middle);
+            if (MonomialOrdering::lessThen(splitters[k], m)) low = middle+1;
+            else high = middle;
+         }
+         bounds[k+1][i] = low;
+      }
+   });
+
+   std::vector<Polynomial<PolyRing, MonomialOrdering>> parts(splitters.size()+1);
+   pool.run(parts.size(), [&](size_t k) {
+      std::vector<std::pair<size_t, size_t>> rows(smaller.terms());
+      for (size_t i = 0; i < smaller.terms(); ++i)
+         rows[i] = std::make_pair(bounds[k][i], bounds[k+1][i]);
+      parts[k] = multiplyRows(smaller, larger, rows);
+   });
+
+   size_t terms = 0;
+   for (auto const &part: parts) terms += part.terms();
+   Polynomial<PolyRing, MonomialOrdering> product(terms);
+   for (auto const &part: parts)
+      for (size_t t = 0; t < part.terms(); ++t)
+         product.appendTerm(part[t]);
+   return product;
+}
 
 
 #endif
@@ -0,0 +1,337 @@
+// primefield.h
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Exact coefficients modulo a prime P (known at compile time).
+// (1) BarrettField<P>     - P < 2^32. A residue is a 32-bit word, and products are reduced by
+//                           Barrett's method (a multiplication by a precomputed 2^64/P).
+//                           Sums of products may be accumulated unreduced (see Accumulator).
+// (2) MontgomeryField<P>  - 2^32 <= P < 2^63 (odd). Residues are kept in Montgomery form
+//                           (a*2^64 mod P), so a product is reduced without any division.
+// (3) PrimeField<P>       - Whichever of the above fits P.
+// (4) PrimeFieldRing<P, N> - A PolyRing policy for Z_P[x1, ..., xn].
+// Inverses are computed by the extended Euclidean algorithm.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+#ifndef primefield_H__
+#define primefield_H__
+
+#include <cstdint>
+#include <cassert>
+#include <ostream>
+#include <type_traits>
+
+#include "exponents.h"
+
+
+// Declarations
+////////////////////////////////////////////////////////////////////////////
+
+// The inverse of a (0 < a < p) modulo p.
+uint64_t inverseModulo(uint64_t a, uint64_t p);
+
+
+// ** class BarrettField
+template<uint64_t P>
+class BarrettField
+{
+   static_assert((P > 1) && (P < (uint64_t(1) << 32)), "BarrettField requires P < 2^32");
+
+public:
+   static const uint64_t MODULUS = P;
+
+   BarrettField(long long v = 0);
+
+   uint64_t value() const;
+   bool isZero() const;
+   BarrettField<P> inverse() const;
+
+   BarrettField<P>& operator+=(BarrettField<P> const &other);
+   BarrettField<P>& operator-=(BarrettField<P> const &other);
+   BarrettField<P>& operator*=(BarrettField<P> const &other);
+   BarrettField<P>& operator/=(BarrettField<P> const &other);
+   BarrettField<P> operator-() const;
+
+   bool operator==(BarrettField<P> const &other) const {return m_value == other.m_value;}
+   bool operator!=(BarrettField<P> const &other) const {return m_value != other.m_value;}
+
+   static uint64_t reduce(uint64_t x); // x mod P
+
+   // A sum of products, reduced only once (the products are accumulated in 128 bits).
+   class Accumulator
+   {
+   public:
+      void add(BarrettField<P> const &a) {m_sum += a.m_value;}
+      void addProduct(BarrettField<P> const &a, BarrettField<P> const &b) {m_sum += uint64_t(a.m_value)*b.m_value;}
+      BarrettField<P> value() const;
+
+   private:
+      unsigned __int128 m_sum = 0;
+   };
+
+private:
+   static constexpr uint64_t MU = ~uint64_t(0)/P;
+   static constexpr uint64_t R64 = (~uint64_t(0))%P+1; // 2^64 mod P (P is not a power of 2).
+
+   uint32_t m_value;
+};
+
+
+// ** class MontgomeryField
+template<uint64_t P>
+class MontgomeryField
+{
+   static_assert((P%2 == 1) && (P < (uint64_t(1) << 63)), "MontgomeryField requires an odd P < 2^63");
+
+public:
+   static const uint64_t MODULUS = P;
+
+   MontgomeryField(long long v = 0);
+
+   uint64_t value() const;
+   bool isZero() const;
+   MontgomeryField<P> inverse() const;
+
+   MontgomeryField<P>& operator+=(MontgomeryField<P> const &other);
+   MontgomeryField<P>& operator-=(MontgomeryField<P> const &other);
+   MontgomeryField<P>& operator*=(MontgomeryField<P> const &other);
+   MontgomeryField<P>& operator/=(MontgomeryField<P> const &other);
+   MontgomeryField<P> operator-() const;
+
+   bool operator==(MontgomeryField<P> const &other) const {return m_value == other.m_value;}
+   bool operator!=(MontgomeryField<P> const &other) const {return m_value != other.m_value;}
+
+private:
+   static constexpr uint64_t negatedInverse(); // -P^-1 mod 2^64
+   static uint64_t redc(unsigned __int128 t); // t/2^64 mod P (t < P*2^64)
+
+   static constexpr uint64_t NEG_INV = negatedInverse();
+   static constexpr uint64_t R2 = uint64_t(((unsigned __int128)((~uint64_t(0))%P+1) * ((~uint64_t(0))%P+1)) % P); // 2^128 mod P
+
+   uint64_t m_value; // Montgomery form.
+};
+
+
+template<uint64_t P>
+using PrimeField = std::conditional_t<(P < (uint64_t(1) << 32)), BarrettField<P>, MontgomeryField<P>>;
+
+template<typename Field, typename = std::enable_if_t<(Field::MODULUS > 0)>>
+Field operator+(Field a, Field const &b) {return a += b;}
+template<typename Field, typename = std::enable_if_t<(Field::MODULUS > 0)>>
+Field operator-(Field a, Field const &b) {return a -= b;}
+template<typename Field, typename = std::enable_if_t<(Field::MODULUS > 0)>>
+Field operator*(Field a, Field const &b) {return a *= b;}
+template<typename Field, typename = std::enable_if_t<(Field::MODULUS > 0)>>
+Field operator/(Field a, Field const &b) {return a /= b;}
+template<typename Field, typename = std::enable_if_t<(Field::MODULUS > 0)>>
+std::ostream& operator<<(std::ostream &out, Field const &a) {return out << a.value();}
+
+
+// ** struct PrimeFieldRing
+// A policy for Z_P[x_1, x_2, ..., x_n].
+template<uint64_t P, size_t VARIABLES_COUNT, typename ExponentsType=DenseExponents<VARIABLES_COUNT>>
+struct PrimeFieldRing
+{
+   using Coefficient = PrimeField<P>;
+   static const size_t VARIABLES = VARIABLES_COUNT;
+   using Exponents = ExponentsType;
+   static bool isZero(Coefficient const &a) {return a.isZero();}
+};
+
+
+
+// Definitions
+////////////////////////////////////////////////////////////////////////////
+
+inline uint64_t inverseModulo(uint64_t a, uint64_t p)
+{
+   assert((a != 0) && (a < p));
+   int64_t t = 0, new_t = 1;
+   uint64_t r = p, new_r = a;
+   while (new_r != 0)
+   {
+      uint64_t q = r/new_r;
+      int64_t next_t = t-int64_t(q)*new_t;
+      t = new_t;
+      new_t = next_t;
+      uint64_t next_r = r-q*new_r;
+      r = new_r;
+      new_r = next_r;
+   }
+   assert(r == 1);
+   return (t < 0) ? uint64_t(t+int64_t(p)) : uint64_t(t);
+}
+
+
+// BarrettField - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+template<uint64_t P>
+BarrettField<P>::BarrettField(long long v)
+{
+   uint64_t r = reduce((v < 0) ? uint64_t(-(v+1)) : uint64_t(v)); // -(v+1) does not overflow.
+   m_value = uint32_t((v < 0) ? (P-1-r) : r);
+}
+
+template<uint64_t P>
+uint64_t BarrettField<P>::reduce(uint64_t x)
+{
+   uint64_t q = uint64_t(((unsigned __int128)x*MU) >> 64);
+   uint64_t r = x-q*P;
+   while (r >= P) r -= P; // At most twice.
+   return r;
+}
+
+template<uint64_t P>
+uint64_t BarrettField<P>::value() const
+{
+   return m_value;
+}
+
+template<uint64_t P>
+bool BarrettField<P>::isZero() const
+{
+   return m_value == 0;
+}
+
+template<uint64_t P>
+BarrettField<P> BarrettField<P>::inverse() const
+{
+   BarrettField<P> res;
+   res.m_value = uint32_t(inverseModulo(m_value, P));
+   return res;
+}
+
+template<uint64_t P>
+BarrettField<P>& BarrettField<P>::operator+=(BarrettField<P> const &other)
+{
+   uint64_t s = uint64_t(m_value)+other.m_value;
+   m_value = uint32_t((s >= P) ? s-P : s);
+   return *this;
+}
+
+template<uint64_t P>
+BarrettField<P>& BarrettField<P>::operator-=(BarrettField<P> const &other)
+{
+   m_value = uint32_t((m_value >= other.m_value) ? m_value-other.m_value : m_value+(P-other.m_value));
+   return *this;
+}
+
+template<uint64_t P>
+BarrettField<P>& BarrettField<P>::operator*=(BarrettField<P> const &other)
+{
+   m_value = uint32_t(reduce(uint64_t(m_value)*other.m_value));
+   return *this;
+}
+
+template<uint64_t P>
+BarrettField<P>& BarrettField<P>::operator/=(BarrettField<P> const &other)
+{
+   return (*this) *= other.inverse();
+}
+
+template<uint64_t P>
+BarrettField<P> BarrettField<P>::operator-() const
+{
+   BarrettField<P> res;
+   res.m_value = uint32_t((m_value == 0) ? 0 : P-m_value);
+   return res;
+}
+
+template<uint64_t P>
+BarrettField<P> BarrettField<P>::Accumulator::value() const
+{
+   // sum = hi*2^64 + lo (hi < 2^64 for fewer than 2^64 products).
+   uint64_t hi = reduce(uint64_t(m_sum >> 64)), lo = reduce(uint64_t(m_sum));
+   BarrettField<P> res;
+   res.m_value = uint32_t(reduce(hi*R64+lo));
+   return res;
+}
+
+
+// MontgomeryField - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+template<uint64_t P>
+constexpr uint64_t MontgomeryField<P>::negatedInverse()
+{
+   // Newton's iteration doubles the number of correct low bits (P*P = 1 mod 8).
+   uint64_t inv = P;
+   for (int i = 0; i < 5; ++i)
+      inv *= 2-P*inv;
+   return ~inv+1;
+}
+
+template<uint64_t P>
+uint64_t MontgomeryField<P>::redc(unsigned __int128 t)
+{
+   uint64_t m = uint64_t(t)*NEG_INV;
+   uint64_t r = uint64_t((t+(unsigned __int128)m*P) >> 64);
+   return (r >= P) ? r-P : r;
+}
+
+template<uint64_t P>
+MontgomeryField<P>::MontgomeryField(long long v)
+{
+   uint64_t r = (v < 0) ? uint64_t(-(v+1))%P : uint64_t(v)%P;
+   if (v < 0) r = P-1-r;
+   m_value = redc((unsigned __int128)r*R2);
+}
+
+template<uint64_t P>
+uint64_t MontgomeryField<P>::value() const
+{
+   return redc(m_value);
+}
+
+template<uint64_t P>
+bool MontgomeryField<P>::isZero() const
+{
+   return m_value == 0;
+}
+
+template<uint64_t P>
+MontgomeryField<P> MontgomeryField<P>::inverse() const
+{
+   return MontgomeryField<P>(inverseModulo(value(), P));
+}
+
+template<uint64_t P>
+MontgomeryField<P>& MontgomeryField<P>::operator+=(MontgomeryField<P> const &other)
+{
+   uint64_t s = m_value+other.m_value;
+   m_value = (s >= P) ? s-P : s;
+   return *this;
+}
+
+template<uint64_t P>
+MontgomeryField<P>& MontgomeryField<P>::operator-=(MontgomeryField<P> const &other)
+{
+   m_value = (m_value >= other.m_value) ? m_value-other.m_value : m_value+(P-other.m_value);
+   return *this;
+}
+
+template<uint64_t P>
+MontgomeryField<P>& MontgomeryField<P>::operator*=(MontgomeryField<P> const &other)
+{
+   m_value = redc((unsigned __int128)m_value*other.m_value);
+   return *this;
+}
+
+template<uint64_t P>
+MontgomeryField<P>& MontgomeryField<P>::operator/=(MontgomeryField<P> const &other)
+{
+   return (*this) *= other.inverse();
+}
+
+template<uint64_t P>
+MontgomeryField<P> MontgomeryField<P>::operator-() const
+{
+   MontgomeryField<P> res;
+   res.m_value = (m_value == 0) ? 0 : P-m_value;
+   return res;
+}
+
+
+#endif
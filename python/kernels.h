@@ -0,0 +1,89 @@
+// kernels.h
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// The instantiations behind the C interface: for every ordering, a RingKernels of every
+// coefficient domain and every count of PYTHON_VARIABLE_COUNTS. Included by one translation unit
+// per ordering (kernels_lex.cpp, kernels_grlex.cpp and kernels_grevlex.cpp).
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef kernels_H__
+#define kernels_H__
+
+#include "python.h"
+
+
+template<typename PolyRing, class MonomialOrdering>
+class RingKernelsOf : public RingKernels
+{
+public:
+   explicit RingKernelsOf(unsigned int variables) : m_variables(variables) {}
+
+   SparseMultiplicationOperation* sparseMultiplication() const override
+   {
+      return new SparseMultiplication<PolyRing, MonomialOrdering>(m_variables);
+   }
+
+   DivisionOperation* division(PolynomialBuffer const &dividend) const override
+   {
+      return new Division<PolyRing, MonomialOrdering>(m_variables, dividend);
+   }
+
+   AdditionOperation* addition() const override
+   {
+      return new Addition<PolyRing, MonomialOrdering>(m_variables);
+   }
+
+   SubtractionOperation* subtraction(PolynomialBuffer const &minuend, PolynomialBuffer const &subtrahend) const override
+   {
+      return new Subtraction<PolyRing, MonomialOrdering>(m_variables, minuend, subtrahend);
+   }
+
+   BuchbergersOperation* buchbergers() const override
+   {
+      return new Buchbergers<PolyRing, MonomialOrdering>(m_variables);
+   }
+
+   BatchOperation* divisionBatch() const override
+   {
+      return new DivisionBatch<PolyRing, MonomialOrdering>(m_variables);
+   }
+
+   BatchOperation* groebnerBatch(GroebnerAlgorithmId algorithm, SelectionStrategyId strategy, bool reduce) const override
+   {
+      return new GroebnerBatch<PolyRing, MonomialOrdering>(m_variables, algorithm, strategy, reduce);
+   }
+
+   GroebnerJobOperation* groebnerJob() const override
+   {
+      return new GroebnerJob<PolyRing, MonomialOrdering>(m_variables);
+   }
+
+private:
+   unsigned int m_variables;
+};
+
+
+// The kernels of the first count (of COUNTS, in increasing order) that fits the variables.
+template<typename Field, class MonomialOrdering, size_t... COUNTS>
+std::unique_ptr<RingKernels> makeRingKernels(unsigned int variables, std::index_sequence<COUNTS...>)
+{
+   std::unique_ptr<RingKernels> kernels;
+   (void)(((variables <= COUNTS) && (kernels = std::make_unique<RingKernelsOf<PythonPolyRing<Field, COUNTS>, MonomialOrdering>>(variables), true)) || ...);
+   return kernels;
+}
+
+template<typename MonomialOrdering>
+std::unique_ptr<RingKernels> makeRingKernels(unsigned int variables, CoefficientDomainId domain)
+{
+   if (variables == 0) return nullptr;
+   switch (domain)
+   {
+      case CoefficientDomainId::Real: return makeRingKernels<double, MonomialOrdering>(variables, PythonVariableCounts());
+      case CoefficientDomainId::Modular: return makeRingKernels<PrimeField<PYTHON_PRIME>, MonomialOrdering>(variables, PythonVariableCounts());
+      default: return nullptr;
+   }
+}
+
+
+#endif
@@ -0,0 +1,4 @@
+#include "kernels.h"
+
+
+template std::unique_ptr<RingKernels> makeRingKernels<LexOrder>(unsigned int, CoefficientDomainId);
@@ -4,174 +4,365 @@ import ctypes
 
 
 class Polynomial(object):
+    """coefficients - an array of the coefficients (float64, or uint32 residues for modular rings).
+       powers - an array of (terms, variables) uint32 powers.
+       Both may be views of storage held by the library (read-only; they keep that storage alive)."""
     def __init__(self, terms, powers, coefficients):
         self._terms = terms
         self._powers = powers
         self._coefficients = coefficients
-        
+
     def __repr__(self):
-        return str(self._terms)
-    
+        return str(self.terms())
+
     def powers(self):
         return self._powers
 
     def coefficients(self):
         return self._coefficients
-    
+
     def terms(self):
+        # Built on demand: results of millions of terms stay in their arrays.
+        if self._terms is None:
+            self._terms = [(self._coefficients[i], list(self._powers[i, :])) for i in range(len(self._coefficients))]
         return self._terms
 
+
+class PolynomialBuffer(ctypes.Structure):
+    """A polynomial in storage that is not copied (see PolynomialBuffer in python.h). Strides are in bytes."""
+    _fields_ = [('terms', ctypes.c_uint32),
+                ('coeffs', ctypes.c_void_p),
+                ('coeffs_type', ctypes.c_uint32),
+                ('coeffs_stride', ctypes.c_size_t),
+                ('powers', ctypes.c_void_p),
+                ('powers_stride', ctypes.c_size_t)]
+
+    # Coefficient types (see CoefficientTypeId in python.h).
+    COEFFICIENT_TYPES = {0: np.float64, 1: np.uint32}
+
+
+class PackedPolynomials(ctypes.Structure):
+    """Many problems in flat arrays (see PackedPolynomials in python.h)."""
+    _fields_ = [('problems', ctypes.c_uint32),
+                ('problem_offsets', ctypes.c_void_p),
+                ('polynomial_offsets', ctypes.c_void_p),
+                ('coeffs', ctypes.c_void_p),
+                ('coeffs_type', ctypes.c_uint32),
+                ('powers', ctypes.c_void_p)]
+
+
+class GroebnerJobProgress(ctypes.Structure):
+    """The progress of a job (see GroebnerJobProgress in python.h)."""
+    _fields_ = [('state', ctypes.c_uint32),
+                ('degree', ctypes.c_uint32),
+                ('basis_size', ctypes.c_ulonglong),
+                ('pairs_remaining', ctypes.c_ulonglong),
+                ('memory', ctypes.c_ulonglong)]
+
+
+class _Handle(object):
+    """Owns a handle of the library (destroyed once neither the handle nor any view of its storage is used)."""
+    def __init__(self, pointer, dtor):
+        self.pointer = ctypes.c_void_p(pointer)
+        self._dtor = dtor
+
+    def __del__(self):
+        self._dtor(self.pointer)
+
+
 class PolynomialRing(object):
-    def __init__(self, sofile):
+    # Monomial orderings (see monomials.h).
+    ORDERINGS = {'lex': 0, 'grlex': 1, 'grevlex': 2}
+    # Coefficient domains: real (doubles) or modular (integers modulo the library's prime, 2^31-1 by default).
+    DOMAINS = {'real': 0, 'modular': 1}
+
+    def __init__(self, sofile, variables=3, ordering='lex', domain='real'):
         self._lib = ctypes.cdll.LoadLibrary(sofile)
+        self._variables = variables
+        self._ring = (ctypes.c_uint32(variables), ctypes.c_uint32(self.ORDERINGS[ordering]), ctypes.c_uint32(self.DOMAINS[domain]))
+        if not self._lib.ringSupported(*self._ring):
+            raise ValueError('The library has no kernels for %d variables' % variables)
         # Addition
-        self._lib.additionCtor.restype = ctypes.c_void_p
-        self._lib.additionTerms.restype = ctypes.c_uint32
-        self._lib.additionResult.restype = ctypes.c_uint32
+        self._lib.additionRingCtor.restype = ctypes.c_void_p
+        self._lib.additionResultView.restype = ctypes.c_uint32
         # Subtraction
-        self._lib.subtractionCtor.restype = ctypes.c_void_p
-        self._lib.subtractionTerms.restype = ctypes.c_uint32
-        self._lib.subtractionResult.restype = ctypes.c_uint32        
+        self._lib.subtractionRingBufferCtor.restype = ctypes.c_void_p
+        self._lib.subtractionResultView.restype = ctypes.c_uint32
         # Sparse Multiplication
-        self._lib.sparseMultiplicationCtor.restype = ctypes.c_void_p
-        self._lib.sparseMultiplicationTerms.restype = ctypes.c_uint32
-        self._lib.sparseMultiplicationResult.restype = ctypes.c_uint32
+        self._lib.sparseMultiplicationRingCtor.restype = ctypes.c_void_p
+        self._lib.sparseMultiplicationResultView.restype = ctypes.c_uint32
         # Polynomial Division
-        self._lib.divisionCtor.restype = ctypes.c_void_p
+        self._lib.divisionRingBufferCtor.restype = ctypes.c_void_p
         self._lib.divisionCalculate.restype = ctypes.c_uint32
-        self._lib.divisionQuotientTerms.restype = ctypes.c_uint32
-        self._lib.divisionRemainderTerms.restype = ctypes.c_uint32
         self._lib.divisionQuotients.restype = ctypes.c_uint32
-        self._lib.divisionQuotient.restype = ctypes.c_uint32
-        self._lib.divisionRemainder.restype = ctypes.c_uint32        
+        self._lib.divisionQuotientView.restype = ctypes.c_uint32
+        self._lib.divisionRemainderView.restype = ctypes.c_uint32
         # Buchberger's Algorithm
-        self._lib.buchbergersCtor.restype = ctypes.c_void_p
+        self._lib.buchbergersRingCtor.restype = ctypes.c_void_p
         self._lib.buchbergersBasisSize.restype = ctypes.c_uint32
         self._lib.buchbergersCalculate.restype = ctypes.c_uint32
         self._lib.buchbergersReduce.restype = ctypes.c_uint32
         self._lib.buchbergersMinimize.restype = ctypes.c_uint32
-        self._lib.buchbergersBasisElementTerms.restype = ctypes.c_uint32
-        self._lib.buchbergersBasisElement.restype = ctypes.c_uint32        
-        
+        self._lib.buchbergersBasisElementView.restype = ctypes.c_uint32
+        self._lib.buchbergersReductions.restype = ctypes.c_uint32
+        self._lib.buchbergersZeroReductions.restype = ctypes.c_uint32
+        self._lib.buchbergersPairsDiscarded.restype = ctypes.c_uint32
+        # Batches
+        self._lib.divisionBatchRingCtor.restype = ctypes.c_void_p
+        self._lib.groebnerBatchRingCtor.restype = ctypes.c_void_p
+        self._lib.batchCalculate.restype = ctypes.c_uint32
+        self._lib.batchResultView.restype = ctypes.c_uint32
+        # Groebner jobs
+        self._lib.groebnerJobRingCtor.restype = ctypes.c_void_p
+        self._lib.groebnerJobWait.restype = ctypes.c_uint32
+        self._lib.groebnerJobBasisSize.restype = ctypes.c_uint32
+        self._lib.groebnerJobBasisElementView.restype = ctypes.c_uint32
+
     def polynomial_from_terms(self, terms):
-        powers = np.zeros((len(terms), 3)).astype(np.uint32)
+        powers = np.zeros((len(terms), self._variables)).astype(np.uint32)
         coefficients = np.zeros(len(terms)).astype(np.float64)
-        for i in xrange(len(terms)):
+        for i in range(len(terms)):
             coefficients[i] = terms[i][0]
-            powers[i, :] = [terms[i][1][0], terms[i][1][1], terms[i][1][2]]
+            powers[i, :] = terms[i][1][:self._variables]
         return Polynomial(terms, powers, coefficients)
-            
+
     def polynomial_from_numpy(self, coefficients, powers):
-        terms = [(coefficients[i], [powers[i, j] for j in xrange(powers.shape[1])]) for i in xrange(len(coefficients))]
-        return Polynomial(terms, powers, coefficients)
+        """The arrays are used as they are (in any order of the terms, and any strides) when their types fit:
+           float64 (or uint32 residues) coefficients, and uint32 powers."""
+        return Polynomial(None, powers, coefficients)
+
+    def _buffer(self, polynomial):
+        """A PolynomialBuffer of the arrays of polynomial (converted only if their types do not fit)."""
+        coefficients = polynomial.coefficients()
+        if coefficients.dtype == np.uint32:
+            coeffs_type = 1
+        else:
+            coefficients = coefficients.astype(np.float64, copy=False)
+            coeffs_type = 0
+        powers = polynomial.powers().astype(np.uint32, copy=False)
+        if len(coefficients) > 0 and (powers.shape[1] != self._variables or powers.strides[1] != 4):
+            powers = np.ascontiguousarray(powers[:, :self._variables])
+        buffer = PolynomialBuffer(len(coefficients),
+                                  coefficients.ctypes.data, coeffs_type, coefficients.strides[0] if len(coefficients) > 0 else 0,
+                                  powers.ctypes.data, powers.strides[0] if len(coefficients) > 0 else 0)
+        buffer._arrays = (coefficients, powers) # Alive while the buffer is.
+        return buffer
+
+    def _view(self, view, handle):
+        """Wraps a view of the storage of handle as a polynomial (no copy)."""
+        dtype = PolynomialBuffer.COEFFICIENT_TYPES[view.coeffs_type]
+        if view.terms == 0:
+            return Polynomial(None, np.zeros((0, self._variables), dtype=np.uint32), np.zeros(0, dtype=dtype))
+        coefficients = self._array(view.coeffs, (view.terms,), dtype, (view.coeffs_stride,), handle)
+        powers = self._array(view.powers, (view.terms, self._variables), np.uint32, (view.powers_stride, 4), handle)
+        return Polynomial(None, powers, coefficients)
+
+    @staticmethod
+    def _array(address, shape, dtype, strides, handle):
+        size = sum((extent-1)*stride for extent, stride in zip(shape, strides)) + np.dtype(dtype).itemsize
+        memory = (ctypes.c_char * size).from_address(address)
+        memory._handle = handle # The storage lives as long as the arrays do.
+        array = np.ndarray(shape, dtype=dtype, buffer=memory, strides=strides)
+        array.flags.writeable = False
+        return array
 
     def add(self, *polynomials):
-        handler = self._lib.additionCtor()
+        handle = _Handle(self._lib.additionRingCtor(*self._ring), self._lib.additionDtor)
         for polynomial in polynomials:
-            self._lib.additionAddSummand(ctypes.c_voidp(handler),
-                                         ctypes.c_uint32(len(polynomial.coefficients())),
-                                         polynomial.coefficients().ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                         polynomial.powers().ctypes.data_as(ctypes.POINTER(ctypes.c_uint32)))
-        terms = self._lib.additionTerms(ctypes.c_voidp(handler))
-        out_coeffs = np.zeros(terms, dtype=np.float64)
-        out_powers = np.zeros((terms, 3), dtype=np.uint32)
-        self._lib.additionResult(ctypes.c_voidp(handler),
-                                 out_coeffs.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                 out_powers.ctypes.data_as(ctypes.POINTER(ctypes.c_double)))
-        self._lib.additionDtor(ctypes.c_voidp(handler))
-        return self.polynomial_from_numpy(out_coeffs, out_powers)
- 
+            self._lib.additionAddSummandBuffer(handle.pointer, ctypes.byref(self._buffer(polynomial)))
+        view = PolynomialBuffer()
+        self._lib.additionResultView(handle.pointer, ctypes.byref(view))
+        return self._view(view, handle)
+
     def sub(self, minuend, subtrahend):
-        handler = self._lib.subtractionCtor(ctypes.c_uint32(len(minuend.coefficients())),
-                                            minuend.coefficients().ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                            minuend.powers().ctypes.data_as(ctypes.POINTER(ctypes.c_uint32)),
-                                            ctypes.c_uint32(len(subtrahend.coefficients())),
-                                            subtrahend.coefficients().ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                            subtrahend.powers().ctypes.data_as(ctypes.POINTER(ctypes.c_uint32)))
-        terms = self._lib.subtractionTerms(ctypes.c_voidp(handler))
-        out_coeffs = np.zeros(terms, dtype=np.float64)
-        out_powers = np.zeros((terms, 3), dtype=np.uint32)
-        self._lib.subtractionResult(ctypes.c_voidp(handler),
-                                    out_coeffs.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                    out_powers.ctypes.data_as(ctypes.POINTER(ctypes.c_double)))
-        self._lib.subtractionDtor(ctypes.c_voidp(handler))
-        return self.polynomial_from_numpy(out_coeffs, out_powers)
+        handle = _Handle(self._lib.subtractionRingBufferCtor(*self._ring,
+                                                             ctypes.byref(self._buffer(minuend)),
+                                                             ctypes.byref(self._buffer(subtrahend))),
+                         self._lib.subtractionDtor)
+        view = PolynomialBuffer()
+        self._lib.subtractionResultView(handle.pointer, ctypes.byref(view))
+        return self._view(view, handle)
 
     def mul(self, *polynomials):
-        handler = self._lib.sparseMultiplicationCtor()
+        handle = _Handle(self._lib.sparseMultiplicationRingCtor(*self._ring), self._lib.sparseMultiplicationDtor)
         for polynomial in polynomials:
-            self._lib.sparseMultiplicationAddMultiplicand(ctypes.c_voidp(handler),
-                                                         ctypes.c_uint32(len(polynomial.coefficients())),
-                                                         polynomial.coefficients().ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                                         polynomial.powers().ctypes.data_as(ctypes.POINTER(ctypes.c_uint32)))
-        terms = self._lib.sparseMultiplicationTerms(ctypes.c_voidp(handler))
-        out_coeffs = np.zeros(terms, dtype=np.float64)
-        out_powers = np.zeros((terms, 3), dtype=np.uint32)
-        self._lib.sparseMultiplicationResult(ctypes.c_voidp(handler),
-                                            out_coeffs.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                            out_powers.ctypes.data_as(ctypes.POINTER(ctypes.c_double)))
-        self._lib.sparseMultiplicationDtor(ctypes.c_voidp(handler))
-        return self.polynomial_from_numpy(out_coeffs, out_powers)
-    
+            self._lib.sparseMultiplicationAddMultiplicandBuffer(handle.pointer, ctypes.byref(self._buffer(polynomial)))
+        view = PolynomialBuffer()
+        self._lib.sparseMultiplicationResultView(handle.pointer, ctypes.byref(view))
+        return self._view(view, handle)
+
     def div(self, dividend, divisors):
-        handler = self._lib.divisionCtor(ctypes.c_uint32(len(dividend.coefficients())),
-                                         dividend.coefficients().ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                         dividend.powers().ctypes.data_as(ctypes.POINTER(ctypes.c_uint32)))
+        handle = _Handle(self._lib.divisionRingBufferCtor(*self._ring, ctypes.byref(self._buffer(dividend))),
+                         self._lib.divisionDtor)
         for divisor in divisors:
-            self._lib.divisionAddDivisor(ctypes.c_voidp(handler),
-                                         ctypes.c_uint32(len(divisor.coefficients())),
-                                         divisor.coefficients().ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                         divisor.powers().ctypes.data_as(ctypes.POINTER(ctypes.c_uint32)))
-        quotients_count = self._lib.divisionCalculate(ctypes.c_voidp(handler))
-        
+            self._lib.divisionAddDivisorBuffer(handle.pointer, ctypes.byref(self._buffer(divisor)))
+        quotients_count = self._lib.divisionCalculate(handle.pointer)
+
         quotients = []
-        for i in xrange(quotients_count):
-            terms = self._lib.divisionQuotientTerms(ctypes.c_voidp(handler), ctypes.c_uint32(i))
-            if terms > 0:
-                out_coeffs = np.zeros(terms, dtype=np.float64)
-                out_powers = np.zeros((terms, 3), dtype=np.uint32)
-                self._lib.divisionQuotient(ctypes.c_voidp(handler),
-                                           ctypes.c_uint32(i),
-                                           out_coeffs.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                           out_powers.ctypes.data_as(ctypes.POINTER(ctypes.c_double)))
-                quotients.append(self.polynomial_from_numpy(out_coeffs, out_powers))
-        terms = self._lib.divisionRemainderTerms(ctypes.c_voidp(handler))
-        out_coeffs = np.zeros(terms, dtype=np.float64)
-        out_powers = np.zeros((terms, 3), dtype=np.uint32)
-        self._lib.divisionRemainder(ctypes.c_voidp(handler),
-                                    out_coeffs.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                    out_powers.ctypes.data_as(ctypes.POINTER(ctypes.c_double)))
-        remainder = self.polynomial_from_numpy(out_coeffs, out_powers)
-        self._lib.divisionDtor(ctypes.c_voidp(handler))
+        view = PolynomialBuffer()
+        for i in range(quotients_count):
+            if self._lib.divisionQuotientView(handle.pointer, ctypes.c_uint32(i), ctypes.byref(view)) > 0:
+                quotients.append(self._view(view, handle))
+        self._lib.divisionRemainderView(handle.pointer, ctypes.byref(view))
+        remainder = self._view(view, handle)
         return quotients, remainder
-    
-    
-    def buchbergers(self, reduce_flag, *generators):
-        handler = self._lib.buchbergersCtor()
+
+
+    # Pair selection strategies (see buchbergers.h).
+    STRATEGIES = {'normal': 0, 'sugar': 1, 'first': 2}
+    # Algorithms (see buchbergers.h and signatures.h).
+    ALGORITHMS = {'buchberger': 0, 'signature': 1}
+
+    def buchbergers(self, reduce_flag, *generators, **options):
+        """Options: algorithm - 'buchberger' (default) or 'signature' (skips most reductions to zero).
+                   strategy - 'normal' (default), 'sugar' or 'first' (Buchberger's algorithm only).
+                   statistics - a dict, filled with the reduction counters of the run."""
+        handle = _Handle(self._lib.buchbergersRingCtor(*self._ring), self._lib.buchbergersDtor)
+        self._lib.buchbergersSetStrategy(handle.pointer,
+                                         ctypes.c_uint32(self.STRATEGIES[options.get('strategy', 'normal')]))
+        self._lib.buchbergersSetAlgorithm(handle.pointer,
+                                          ctypes.c_uint32(self.ALGORITHMS[options.get('algorithm', 'buchberger')]))
         for generator in generators:
-            self._lib.buchbergersAddGenerator(ctypes.c_voidp(handler),
-                                              ctypes.c_uint32(len(generator.coefficients())),
-                                              generator.coefficients().ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                              generator.powers().ctypes.data_as(ctypes.POINTER(ctypes.c_uint32)))
-        basis_size = self._lib.buchbergersCalculate(ctypes.c_voidp(handler))
+            self._lib.buchbergersAddGeneratorBuffer(handle.pointer, ctypes.byref(self._buffer(generator)))
+        basis_size = self._lib.buchbergersCalculate(handle.pointer)
+        statistics = options.get('statistics')
+        if statistics is not None:
+            statistics['reductions'] = self._lib.buchbergersReductions(handle.pointer)
+            statistics['zero_reductions'] = self._lib.buchbergersZeroReductions(handle.pointer)
+            statistics['pairs_discarded'] = self._lib.buchbergersPairsDiscarded(handle.pointer)
         if reduce_flag:
-            basis_size = self._lib.buchbergersReduce(ctypes.c_voidp(handler))
-        
+            basis_size = self._lib.buchbergersReduce(handle.pointer)
+
+        groebner = []
+        view = PolynomialBuffer()
+        for i in range(basis_size):
+            self._lib.buchbergersBasisElementView(handle.pointer, ctypes.c_uint32(i), ctypes.byref(view))
+            groebner.append(self._view(view, handle))
+        return groebner
+
+    def buchbergers_async(self, reduce_flag, *generators, **options):
+        """Starts Buchberger's algorithm on a thread of the library, and returns its GroebnerJob at once.
+           Options: strategy - as for buchbergers.
+                    time_limit - seconds of wall time, and memory_limit - bytes of polynomials (unbounded by default).
+           The job stops at a limit, or when cancelled, with a partial basis."""
+        handle = _Handle(self._lib.groebnerJobRingCtor(*self._ring), self._lib.groebnerJobDtor)
+        for generator in generators:
+            self._lib.groebnerJobAddGeneratorBuffer(handle.pointer, ctypes.byref(self._buffer(generator)))
+        self._lib.groebnerJobStart(handle.pointer,
+                                   ctypes.c_uint32(self.STRATEGIES[options.get('strategy', 'normal')]),
+                                   ctypes.c_uint32(1 if reduce_flag else 0),
+                                   ctypes.c_double(options.get('time_limit') or 0),
+                                   ctypes.c_ulonglong(options.get('memory_limit') or 0))
+        return GroebnerJob(self, handle)
+
+    # Batches: many independent problems, solved by the library's threads (the GIL is released meanwhile).
+    # A batch is packed as (problem_offsets, polynomial_offsets, coefficients, powers): problem b has the
+    # polynomials problem_offsets[b]:problem_offsets[b+1], and polynomial p has the rows
+    # polynomial_offsets[p]:polynomial_offsets[p+1] of coefficients and powers. Results are packed alike.
+
+    def pack(self, problems):
+        """Packs problems (each a list of polynomials)."""
+        polynomials = [polynomial for problem in problems for polynomial in problem]
+        problem_offsets = np.zeros(len(problems)+1, dtype=np.uint32)
+        problem_offsets[1:] = np.cumsum([len(problem) for problem in problems])
+        polynomial_offsets = np.zeros(len(polynomials)+1, dtype=np.uint32)
+        polynomial_offsets[1:] = np.cumsum([len(polynomial.coefficients()) for polynomial in polynomials])
+        coefficients = np.concatenate([polynomial.coefficients() for polynomial in polynomials] or [np.zeros(0)])
+        powers = np.concatenate([polynomial.powers() for polynomial in polynomials] or [np.zeros((0, self._variables))])
+        return problem_offsets, polynomial_offsets, coefficients, powers.astype(np.uint32, copy=False)
+
+    def unpack(self, packed):
+        """The problems of a packed batch, as lists of polynomials (views of the packed arrays)."""
+        problem_offsets, polynomial_offsets, coefficients, powers = packed
+        return [[Polynomial(None, powers[polynomial_offsets[p]:polynomial_offsets[p+1]], coefficients[polynomial_offsets[p]:polynomial_offsets[p+1]])
+                 for p in range(problem_offsets[b], problem_offsets[b+1])]
+                for b in range(len(problem_offsets)-1)]
+
+    def division_batch(self, packed):
+        """Problems of (dividend, divisors...). Returns the packed results: (remainder, quotients...) per problem."""
+        handle = _Handle(self._lib.divisionBatchRingCtor(*self._ring), self._lib.batchDtor)
+        return self._solve_batch(handle, packed)
+
+    def groebner_batch(self, reduce_flag, packed, **options):
+        """Problems of generators (the options of buchbergers). Returns the packed bases."""
+        handle = _Handle(self._lib.groebnerBatchRingCtor(*self._ring,
+                                                         ctypes.c_uint32(self.ALGORITHMS[options.get('algorithm', 'buchberger')]),
+                                                         ctypes.c_uint32(self.STRATEGIES[options.get('strategy', 'normal')]),
+                                                         ctypes.c_uint32(1 if reduce_flag else 0)),
+                         self._lib.batchDtor)
+        return self._solve_batch(handle, packed)
+
+    def div_batch(self, problems):
+        """problems - a list of (dividend, divisors). Returns a list of (quotients, remainder), as div does."""
+        results = self.unpack(self.division_batch(self.pack([[dividend] + list(divisors) for dividend, divisors in problems])))
+        return [([q for q in result[1:] if len(q.coefficients()) > 0], result[0]) for result in results]
+
+    def buchbergers_batch(self, reduce_flag, problems, **options):
+        """problems - a list of lists of generators. Returns a list of bases."""
+        return self.unpack(self.groebner_batch(reduce_flag, self.pack(problems), **options))
+
+    def _solve_batch(self, handle, packed):
+        problem_offsets, polynomial_offsets, coefficients, powers = packed
+        problem_offsets = np.ascontiguousarray(problem_offsets, dtype=np.uint32)
+        polynomial_offsets = np.ascontiguousarray(polynomial_offsets, dtype=np.uint32)
+        if coefficients.dtype != np.uint32:
+            coefficients = np.ascontiguousarray(coefficients, dtype=np.float64)
+        powers = np.ascontiguousarray(powers, dtype=np.uint32)
+        problems = PackedPolynomials(len(problem_offsets)-1, problem_offsets.ctypes.data, polynomial_offsets.ctypes.data,
+                                     coefficients.ctypes.data, 1 if coefficients.dtype == np.uint32 else 0, powers.ctypes.data)
+        polynomials = self._lib.batchCalculate(handle.pointer, ctypes.byref(problems))
+        view = PackedPolynomials()
+        terms = self._lib.batchResultView(handle.pointer, ctypes.byref(view))
+        dtype = PolynomialBuffer.COEFFICIENT_TYPES[view.coeffs_type]
+        result_problem_offsets = self._array(view.problem_offsets, (view.problems+1,), np.uint32, (4,), handle)
+        result_polynomial_offsets = self._array(view.polynomial_offsets, (polynomials+1,), np.uint32, (4,), handle)
+        if terms == 0: # Empty arrays have no storage to view.
+            return result_problem_offsets, result_polynomial_offsets, np.zeros(0, dtype=dtype), np.zeros((0, self._variables), dtype=np.uint32)
+        return (result_problem_offsets, result_polynomial_offsets,
+                self._array(view.coeffs, (terms,), dtype, (np.dtype(dtype).itemsize,), handle),
+                self._array(view.powers, (terms, self._variables), np.uint32, (4*self._variables, 4), handle))
+
+
+class GroebnerJob(object):
+    """A Groebner basis being computed in the background (see PolynomialRing.buchbergers_async)."""
+    # Job states (see JobStateId in python.h).
+    STATES = {0: 'idle', 1: 'running', 2: 'completed', 3: 'cancelled', 4: 'timed_out', 5: 'out_of_memory'}
+
+    def __init__(self, ring, handle):
+        self._ring = ring
+        self._lib = ring._lib
+        self._handle = handle
+
+    def progress(self):
+        """A dict of: state, basis_size, pairs_remaining, degree (of the latest pair) and memory (bytes)."""
+        progress = GroebnerJobProgress()
+        self._lib.groebnerJobProgress(self._handle.pointer, ctypes.byref(progress))
+        return {'state': self.STATES[progress.state], 'basis_size': progress.basis_size, 'pairs_remaining': progress.pairs_remaining,
+                'degree': progress.degree, 'memory': progress.memory}
+
+    def cancel(self):
+        """Asks the job to stop (after the pair it is reducing). Returns at once."""
+        self._lib.groebnerJobCancel(self._handle.pointer)
+
+    def wait(self, timeout=None):
+        """Waits for the job to end, up to timeout seconds (with no bound, if None). Returns the state."""
+        return self.STATES[self._lib.groebnerJobWait(self._handle.pointer, ctypes.c_double(-1 if timeout is None else timeout))]
+
+    def done(self):
+        return self.wait(0) != 'running'
+
+    def basis(self):
+        """The basis (waits for the job to end): a Groebner basis if the job completed, or else a partial one - the
+           generators and the remainders found so far, which generate the same ideal."""
+        self.wait()
         groebner = []
-        for i in xrange(basis_size):
-            terms = self._lib.buchbergersBasisElementTerms(ctypes.c_voidp(handler),ctypes.c_uint32(i))
-            out_coeffs = np.zeros(terms, dtype=np.float64)
-            out_powers = np.zeros((terms, 3), dtype=np.uint32)
-            self._lib.buchbergersBasisElement(ctypes.c_voidp(handler),
-                                              ctypes.c_uint32(i),
-                                              out_coeffs.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
-                                              out_powers.ctypes.data_as(ctypes.POINTER(ctypes.c_double)))
-            groebner.append(self.polynomial_from_numpy(out_coeffs, out_powers))
-        self._lib.buchbergersDtor(ctypes.c_voidp(handler))
+        view = PolynomialBuffer()
+        for i in range(self._lib.groebnerJobBasisSize(self._handle.pointer)):
+            self._lib.groebnerJobBasisElementView(self._handle.pointer, ctypes.c_uint32(i), ctypes.byref(view))
+            groebner.append(self._ring._view(view, self._handle))
         return groebner
 
-    
-    
+
 def find_standard_monomial_basis(groebner_basis):
     LT = set([tuple(p.terms()[0][1]) for p in groebner_basis])
-    return set([z for y in [list(itertools.product(xrange(i+1),xrange(j+1),xrange(k+1))) for i,j,k in LT] for z in y]).difference(LT)
+    return set([z for y in [list(itertools.product(*[range(power+1) for power in powers])) for powers in LT] for z in y]).difference(LT)
@@ -1,191 +1,457 @@
 #include "python.h"
 
 
+namespace
+{
+   RingDescriptor makeRingDescriptor(unsigned int variables, unsigned int ordering, unsigned int domain)
+   {
+      RingDescriptor ring;
+      ring.variables = variables;
+      ring.ordering = static_cast<OrderingId>(ordering);
+      ring.domain = static_cast<CoefficientDomainId>(domain);
+      return ring;
+   }
+
+   const unsigned int DEFAULT_VARIABLES = RingDescriptor().variables;
+}
+
+
+// Every operation has two interfaces:
+// (1) Contiguous arrays: (terms, coeffs, powers) in, and ...Terms() followed by a copy into arrays of that
+//     size out (e.g. additionAddSummand, additionTerms, additionResult).
+// (2) Buffers: PolynomialBuffer in (any strides, e.g. of NumPy arrays), and a view of the handle's storage
+//     out (e.g. additionAddSummandBuffer, additionResultView), so large polynomials are never copied across.
 extern "C"
 {
+   // Rings
+   //////////////////////////////////////////////////////////////////////////
+
+   // Whether handles may be created over (variables, ordering, domain). The Ctor functions create handles over
+   // the default ring (3 variables, lex, real coefficients), and the RingCtor ones over the given ring (or
+   // return null when it is not supported).
+   unsigned int ringSupported(unsigned int variables, unsigned int ordering, unsigned int domain)
+   {
+      return makeRingKernels(makeRingDescriptor(variables, ordering, domain)) != nullptr;
+   }
+
+
    // Sparse Multiplication
    //////////////////////////////////////////////////////////////////////////
 
+   void* sparseMultiplicationRingCtor(unsigned int variables, unsigned int ordering, unsigned int domain)
+   {
+      auto kernels = makeRingKernels(makeRingDescriptor(variables, ordering, domain));
+      return kernels ? kernels->sparseMultiplication() : nullptr;
+   }
+
    void* sparseMultiplicationCtor()
    {
-      return new SparseMultiplication<PythonPolyRing, PythonOrdering>();
+      return makeRingKernels(RingDescriptor())->sparseMultiplication();
    }
 
    void sparseMultiplicationDtor(void *handler)
    {
-      delete static_cast<SparseMultiplication<PythonPolyRing, PythonOrdering>*>(handler);
+      delete static_cast<SparseMultiplicationOperation*>(handler);
    }
 
    void sparseMultiplicationAddMultiplicand(void *handler, unsigned int terms, double const * const coeffs, unsigned int const * const powers)
    {
-      static_cast<SparseMultiplication<PythonPolyRing, PythonOrdering>*>(handler)->addMultiplicand(importPolynomial<PythonPolyRing, PythonOrdering>(terms, coeffs, powers));
+      auto operation = static_cast<SparseMultiplicationOperation*>(handler);
+      operation->addMultiplicand(denseBuffer(operation->variables(), terms, coeffs, powers));
+   }
+
+   void sparseMultiplicationAddMultiplicandBuffer(void *handler, PolynomialBuffer const *multiplicand)
+   {
+      static_cast<SparseMultiplicationOperation*>(handler)->addMultiplicand(*multiplicand);
    }
 
    unsigned int sparseMultiplicationTerms(void *handler)
    {
-      return static_cast<SparseMultiplication<PythonPolyRing, PythonOrdering>*>(handler)->result().terms();
+      return static_cast<SparseMultiplicationOperation*>(handler)->result().terms;
    }
 
    unsigned int sparseMultiplicationResult(void *handler, double * out_coeffs, unsigned int * out_powers)
    {
-      return exportPolynomial(static_cast<SparseMultiplication<PythonPolyRing, PythonOrdering>*>(handler)->result(), out_coeffs, out_powers);
+      auto operation = static_cast<SparseMultiplicationOperation*>(handler);
+      return exportPolynomial(operation->variables(), operation->result(), out_coeffs, out_powers);
+   }
+
+   unsigned int sparseMultiplicationResultView(void *handler, PolynomialBuffer *out_view)
+   {
+      *out_view = static_cast<SparseMultiplicationOperation*>(handler)->result();
+      return out_view->terms;
    }
 
 
 
    // Polynomial Division
    //////////////////////////////////////////////////////////////////////////
+   void* divisionRingCtor(unsigned int variables, unsigned int ordering, unsigned int domain,
+                          unsigned int terms, double const * const coeffs, unsigned int const * const powers)
+   {
+      auto kernels = makeRingKernels(makeRingDescriptor(variables, ordering, domain));
+      return kernels ? kernels->division(denseBuffer(variables, terms, coeffs, powers)) : nullptr;
+   }
+
+   void* divisionRingBufferCtor(unsigned int variables, unsigned int ordering, unsigned int domain, PolynomialBuffer const *dividend)
+   {
+      auto kernels = makeRingKernels(makeRingDescriptor(variables, ordering, domain));
+      return kernels ? kernels->division(*dividend) : nullptr;
+   }
+
    void* divisionCtor(unsigned int terms, double const * const coeffs, unsigned int const * const powers)
    {
-      return new Division<PythonPolyRing, PythonOrdering>(importPolynomial<PythonPolyRing, PythonOrdering>(terms, coeffs, powers));
+      return makeRingKernels(RingDescriptor())->division(denseBuffer(DEFAULT_VARIABLES, terms, coeffs, powers));
    }
 
    void divisionDtor(void *handler)
    {
-      delete static_cast<Division<PythonPolyRing, PythonOrdering>*>(handler);
+      delete static_cast<DivisionOperation*>(handler);
    }
 
    void divisionAddDivisor(void *handler, unsigned int terms, double const * const coeffs, unsigned int const * const powers)
    {
-      static_cast<Division<PythonPolyRing, PythonOrdering>*>(handler)->addDivisor(importPolynomial<PythonPolyRing, PythonOrdering>(terms, coeffs, powers));
+      auto operation = static_cast<DivisionOperation*>(handler);
+      operation->addDivisor(denseBuffer(operation->variables(), terms, coeffs, powers));
+   }
+
+   void divisionAddDivisorBuffer(void *handler, PolynomialBuffer const *divisor)
+   {
+      static_cast<DivisionOperation*>(handler)->addDivisor(*divisor);
    }
 
    unsigned int divisionCalculate(void *handler)
    {
-      static_cast<Division<PythonPolyRing, PythonOrdering>*>(handler)->calculate();
-      return static_cast<Division<PythonPolyRing, PythonOrdering>*>(handler)->quotients();
+      static_cast<DivisionOperation*>(handler)->calculate();
+      return static_cast<DivisionOperation*>(handler)->quotients();
    }
 
    unsigned int divisionQuotients(void *handler)
    {
-      return static_cast<Division<PythonPolyRing, PythonOrdering>*>(handler)->quotients();
+      return static_cast<DivisionOperation*>(handler)->quotients();
    }
 
    unsigned int divisionQuotientTerms(void *handler, unsigned int i)
    {
-      return static_cast<Division<PythonPolyRing, PythonOrdering>*>(handler)->quotient(i).terms();
+      return static_cast<DivisionOperation*>(handler)->quotient(i).terms;
    }
 
    unsigned int divisionQuotient(void *handler, unsigned int i, double * out_coeffs, unsigned int * out_powers)
    {
-      return exportPolynomial(static_cast<Division<PythonPolyRing, PythonOrdering>*>(handler)->quotient(i), out_coeffs, out_powers);
+      auto operation = static_cast<DivisionOperation*>(handler);
+      return exportPolynomial(operation->variables(), operation->quotient(i), out_coeffs, out_powers);
+   }
+
+   unsigned int divisionQuotientView(void *handler, unsigned int i, PolynomialBuffer *out_view)
+   {
+      *out_view = static_cast<DivisionOperation*>(handler)->quotient(i);
+      return out_view->terms;
    }
 
    unsigned int divisionRemainderTerms(void *handler)
    {
-      return static_cast<Division<PythonPolyRing, PythonOrdering>*>(handler)->remainder().terms();
+      return static_cast<DivisionOperation*>(handler)->remainder().terms;
    }
 
    unsigned int divisionRemainder(void *handler, double * out_coeffs, unsigned int * out_powers)
    {
-      return exportPolynomial(static_cast<Division<PythonPolyRing, PythonOrdering>*>(handler)->remainder(), out_coeffs, out_powers);
+      auto operation = static_cast<DivisionOperation*>(handler);
+      return exportPolynomial(operation->variables(), operation->remainder(), out_coeffs, out_powers);
+   }
+
+   unsigned int divisionRemainderView(void *handler, PolynomialBuffer *out_view)
+   {
+      *out_view = static_cast<DivisionOperation*>(handler)->remainder();
+      return out_view->terms;
    }
 
 
    // Addition
    //////////////////////////////////////////////////////////////////////////
 
+   void* additionRingCtor(unsigned int variables, unsigned int ordering, unsigned int domain)
+   {
+      auto kernels = makeRingKernels(makeRingDescriptor(variables, ordering, domain));
+      return kernels ? kernels->addition() : nullptr;
+   }
+
    void* additionCtor()
    {
-      return new Addition<PythonPolyRing, PythonOrdering>();
+      return makeRingKernels(RingDescriptor())->addition();
    }
 
    void additionDtor(void *handler)
    {
-      delete static_cast<Addition<PythonPolyRing, PythonOrdering>*>(handler);
+      delete static_cast<AdditionOperation*>(handler);
    }
 
    void additionAddSummand(void *handler, unsigned int terms, double const * const coeffs, unsigned int const * const powers)
    {
-      static_cast<Addition<PythonPolyRing, PythonOrdering>*>(handler)->addSummand(importPolynomial<PythonPolyRing, PythonOrdering>(terms, coeffs, powers));
+      auto operation = static_cast<AdditionOperation*>(handler);
+      operation->addSummand(denseBuffer(operation->variables(), terms, coeffs, powers));
+   }
+
+   void additionAddSummandBuffer(void *handler, PolynomialBuffer const *summand)
+   {
+      static_cast<AdditionOperation*>(handler)->addSummand(*summand);
    }
 
    unsigned int additionTerms(void *handler)
    {
-      return static_cast<Addition<PythonPolyRing, PythonOrdering>*>(handler)->result().terms();
+      return static_cast<AdditionOperation*>(handler)->result().terms;
    }
 
    unsigned int additionResult(void *handler, double * out_coeffs, unsigned int * out_powers)
    {
-      return exportPolynomial(static_cast<Addition<PythonPolyRing, PythonOrdering>*>(handler)->result(), out_coeffs, out_powers);
+      auto operation = static_cast<AdditionOperation*>(handler);
+      return exportPolynomial(operation->variables(), operation->result(), out_coeffs, out_powers);
+   }
+
+   unsigned int additionResultView(void *handler, PolynomialBuffer *out_view)
+   {
+      *out_view = static_cast<AdditionOperation*>(handler)->result();
+      return out_view->terms;
    }
 
 
    // Subtraction
    //////////////////////////////////////////////////////////////////////////
 
-   void* subtractionCtor(unsigned int subtrahend_terms, double const * const subtrahend_coeffs, unsigned int const * const subtrahend_powers,
-                         unsigned int minuend_terms, double const * const minuend_coeffs, unsigned int const * const minuend_powers)
+   void* subtractionRingCtor(unsigned int variables, unsigned int ordering, unsigned int domain,
+                             unsigned int minuend_terms, double const * const minuend_coeffs, unsigned int const * const minuend_powers,
+                             unsigned int subtrahend_terms, double const * const subtrahend_coeffs, unsigned int const * const subtrahend_powers)
+   {
+      auto kernels = makeRingKernels(makeRingDescriptor(variables, ordering, domain));
+      return kernels ? kernels->subtraction(denseBuffer(variables, minuend_terms, minuend_coeffs, minuend_powers),
+                                            denseBuffer(variables, subtrahend_terms, subtrahend_coeffs, subtrahend_powers)) : nullptr;
+   }
+
+   void* subtractionRingBufferCtor(unsigned int variables, unsigned int ordering, unsigned int domain,
+                                   PolynomialBuffer const *minuend, PolynomialBuffer const *subtrahend)
    {
-      return new Subtraction<PythonPolyRing, PythonOrdering>(importPolynomial<PythonPolyRing, PythonOrdering>(subtrahend_terms, subtrahend_coeffs, subtrahend_powers),
-                                                             importPolynomial<PythonPolyRing, PythonOrdering>(minuend_terms, minuend_coeffs, minuend_powers));
+      auto kernels = makeRingKernels(makeRingDescriptor(variables, ordering, domain));
+      return kernels ? kernels->subtraction(*minuend, *subtrahend) : nullptr;
+   }
+
+   void* subtractionCtor(unsigned int minuend_terms, double const * const minuend_coeffs, unsigned int const * const minuend_powers,
+                         unsigned int subtrahend_terms, double const * const subtrahend_coeffs, unsigned int const * const subtrahend_powers)
+   {
+      return makeRingKernels(RingDescriptor())->subtraction(denseBuffer(DEFAULT_VARIABLES, minuend_terms, minuend_coeffs, minuend_powers),
+                                                            denseBuffer(DEFAULT_VARIABLES, subtrahend_terms, subtrahend_coeffs, subtrahend_powers));
    }
 
    void subtractionDtor(void *handler)
    {
-      delete static_cast<Subtraction<PythonPolyRing, PythonOrdering>*>(handler);
+      delete static_cast<SubtractionOperation*>(handler);
    }
 
    unsigned int subtractionTerms(void *handler)
    {
-      return static_cast<Subtraction<PythonPolyRing, PythonOrdering>*>(handler)->result().terms();
+      return static_cast<SubtractionOperation*>(handler)->result().terms;
    }
 
    unsigned int subtractionResult(void *handler, double * out_coeffs, unsigned int * out_powers)
    {
-      return exportPolynomial(static_cast<Subtraction<PythonPolyRing, PythonOrdering>*>(handler)->result(), out_coeffs, out_powers);
+      auto operation = static_cast<SubtractionOperation*>(handler);
+      return exportPolynomial(operation->variables(), operation->result(), out_coeffs, out_powers);
+   }
+
+   unsigned int subtractionResultView(void *handler, PolynomialBuffer *out_view)
+   {
+      *out_view = static_cast<SubtractionOperation*>(handler)->result();
+      return out_view->terms;
    }
 
 
 
    // Buchbergers
    //////////////////////////////////////////////////////////////////////////
+   void* buchbergersRingCtor(unsigned int variables, unsigned int ordering, unsigned int domain)
+   {
+      auto kernels = makeRingKernels(makeRingDescriptor(variables, ordering, domain));
+      return kernels ? kernels->buchbergers() : nullptr;
+   }
+
    void* buchbergersCtor()
    {
-      return new Buchbergers<PythonPolyRing, PythonOrdering>();
+      return makeRingKernels(RingDescriptor())->buchbergers();
    }
 
    void buchbergersDtor(void *handler)
    {
-      delete static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler);
+      delete static_cast<BuchbergersOperation*>(handler);
    }
 
    void buchbergersAddGenerator(void *handler, unsigned int terms, double const * const coeffs, unsigned int const * const powers)
    {
-      static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler)->addIdealGenerator(importPolynomial<PythonPolyRing, PythonOrdering>(terms, coeffs, powers));
+      auto operation = static_cast<BuchbergersOperation*>(handler);
+      operation->addIdealGenerator(denseBuffer(operation->variables(), terms, coeffs, powers));
+   }
+
+   void buchbergersAddGeneratorBuffer(void *handler, PolynomialBuffer const *generator)
+   {
+      static_cast<BuchbergersOperation*>(handler)->addIdealGenerator(*generator);
+   }
+
+   void buchbergersSetStrategy(void *handler, unsigned int strategy)
+   {
+      static_cast<BuchbergersOperation*>(handler)->setStrategy(static_cast<SelectionStrategyId>(strategy));
+   }
+
+   void buchbergersSetAlgorithm(void *handler, unsigned int algorithm)
+   {
+      static_cast<BuchbergersOperation*>(handler)->setAlgorithm(static_cast<GroebnerAlgorithmId>(algorithm));
+   }
+
+   unsigned int buchbergersReductions(void *handler)
+   {
+      return static_cast<BuchbergersOperation*>(handler)->statistics().reductions;
+   }
+
+   unsigned int buchbergersZeroReductions(void *handler)
+   {
+      return static_cast<BuchbergersOperation*>(handler)->statistics().zero_reductions;
+   }
+
+   unsigned int buchbergersPairsDiscarded(void *handler)
+   {
+      return static_cast<BuchbergersOperation*>(handler)->statistics().pairs_discarded;
    }
 
    unsigned int buchbergersCalculate(void *handler)
    {
-      static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler)->calculate();
-      return static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler)->basisSize();
+      static_cast<BuchbergersOperation*>(handler)->calculate();
+      return static_cast<BuchbergersOperation*>(handler)->basisSize();
    }
 
    unsigned int buchbergersReduce(void *handler)
    {
-      static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler)->reduce();
-      return static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler)->basisSize();
+      static_cast<BuchbergersOperation*>(handler)->reduce();
+      return static_cast<BuchbergersOperation*>(handler)->basisSize();
    }
 
    unsigned int buchbergersMinimize(void *handler)
    {
-      static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler)->minimize();
-      return static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler)->basisSize();
+      static_cast<BuchbergersOperation*>(handler)->minimize();
+      return static_cast<BuchbergersOperation*>(handler)->basisSize();
    }
 
    unsigned int buchbergersBasisSize(void *handler)
    {
-      return static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler)->basisSize();
+      return static_cast<BuchbergersOperation*>(handler)->basisSize();
    }
 
    unsigned int buchbergersBasisElementTerms(void *handler, unsigned int i)
    {
-      return static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler)->basisElement(i).terms();
+      return static_cast<BuchbergersOperation*>(handler)->basisElement(i).terms;
    }
 
    unsigned int buchbergersBasisElement(void *handler, unsigned int i, double * out_coeffs, unsigned int * out_powers)
    {
-      return exportPolynomial(static_cast<Buchbergers<PythonPolyRing, PythonOrdering>*>(handler)->basisElement(i), out_coeffs, out_powers);
+      auto operation = static_cast<BuchbergersOperation*>(handler);
+      return exportPolynomial(operation->variables(), operation->basisElement(i), out_coeffs, out_powers);
+   }
+
+   unsigned int buchbergersBasisElementView(void *handler, unsigned int i, PolynomialBuffer *out_view)
+   {
+      *out_view = static_cast<BuchbergersOperation*>(handler)->basisElement(i);
+      return out_view->terms;
+   }
+
+
+
+   // Batches
+   //////////////////////////////////////////////////////////////////////////
+
+   // Problems of (dividend, divisors...), with results of (remainder, quotients...).
+   void* divisionBatchRingCtor(unsigned int variables, unsigned int ordering, unsigned int domain)
+   {
+      auto kernels = makeRingKernels(makeRingDescriptor(variables, ordering, domain));
+      return kernels ? kernels->divisionBatch() : nullptr;
+   }
+
+   // Problems of (generators...), with results of (the basis...), reduced unless reduce is 0.
+   void* groebnerBatchRingCtor(unsigned int variables, unsigned int ordering, unsigned int domain,
+                               unsigned int algorithm, unsigned int strategy, unsigned int reduce)
+   {
+      auto kernels = makeRingKernels(makeRingDescriptor(variables, ordering, domain));
+      return kernels ? kernels->groebnerBatch(static_cast<GroebnerAlgorithmId>(algorithm), static_cast<SelectionStrategyId>(strategy), reduce != 0) : nullptr;
+   }
+
+   void batchDtor(void *handler)
+   {
+      delete static_cast<BatchOperation*>(handler);
+   }
+
+   // Solves the problems (on the library's threads). Returns the number of result polynomials.
+   unsigned int batchCalculate(void *handler, PackedPolynomials const *problems)
+   {
+      auto operation = static_cast<BatchOperation*>(handler);
+      operation->calculate(*problems);
+      auto results = operation->result();
+      return results.problem_offsets[results.problems];
+   }
+
+   // Returns the number of result terms.
+   unsigned int batchResultView(void *handler, PackedPolynomials *out_view)
+   {
+      *out_view = static_cast<BatchOperation*>(handler)->result();
+      return out_view->polynomial_offsets[out_view->problem_offsets[out_view->problems]];
+   }
+
+
+
+   // Groebner jobs
+   //////////////////////////////////////////////////////////////////////////
+
+   void* groebnerJobRingCtor(unsigned int variables, unsigned int ordering, unsigned int domain)
+   {
+      auto kernels = makeRingKernels(makeRingDescriptor(variables, ordering, domain));
+      return kernels ? kernels->groebnerJob() : nullptr;
+   }
+
+   // Cancels the run, and waits for it to stop.
+   void groebnerJobDtor(void *handler)
+   {
+      delete static_cast<GroebnerJobOperation*>(handler);
+   }
+
+   void groebnerJobAddGeneratorBuffer(void *handler, PolynomialBuffer const *generator)
+   {
+      static_cast<GroebnerJobOperation*>(handler)->addIdealGenerator(*generator);
+   }
+
+   // Limits of 0 are unbounded. The basis is reduced (if the run completes) unless reduce is 0.
+   void groebnerJobStart(void *handler, unsigned int strategy, unsigned int reduce, double seconds, unsigned long long memory)
+   {
+      static_cast<GroebnerJobOperation*>(handler)->start(static_cast<SelectionStrategyId>(strategy), reduce != 0, seconds, memory);
+   }
+
+   void groebnerJobCancel(void *handler)
+   {
+      static_cast<GroebnerJobOperation*>(handler)->cancel();
+   }
+
+   void groebnerJobProgress(void *handler, GroebnerJobProgress *out_progress)
+   {
+      *out_progress = static_cast<GroebnerJobOperation*>(handler)->progress();
+   }
+
+   // Waits up to seconds (with no bound, if negative). Returns the state.
+   unsigned int groebnerJobWait(void *handler, double seconds)
+   {
+      return static_cast<unsigned int>(static_cast<GroebnerJobOperation*>(handler)->wait(seconds));
+   }
+
+   unsigned int groebnerJobBasisSize(void *handler)
+   {
+      return static_cast<GroebnerJobOperation*>(handler)->basisSize();
+   }
+
+   unsigned int groebnerJobBasisElementView(void *handler, unsigned int i, PolynomialBuffer *out_view)
+   {
+      *out_view = static_cast<GroebnerJobOperation*>(handler)->basisElement(i);
+      return out_view->terms;
    }
 
 
@@ -4,15 +4,72 @@
 #ifndef python_H__
 #define python_H__
 
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include <condition_variable>
+
 #include "monomials.h"
 #include "polynomials.h"
 #include "division.h"
 #include "buchbergers.h"
+#include "signatures.h"
+#include "geobuckets.h"
+#include "primefield.h"
+
+
+// Coefficient domains (as passed through the C interface). Coefficients cross the interface as doubles
+// (residues modulo PYTHON_PRIME as whole numbers), or as 32-bit residues (see PolynomialBuffer).
+enum class CoefficientDomainId : unsigned int
+{
+   Real = 0,
+   Modular = 1
+};
+
+#ifndef PYTHON_PRIME
+#define PYTHON_PRIME 2147483647
+#endif
 
+// The variable counts with kernels of their own (in increasing order). Any other count, up to the largest,
+// runs on the kernels of the next count: the extra variables keep zero powers, which changes none of the orderings.
+#ifndef PYTHON_VARIABLE_COUNTS
+#define PYTHON_VARIABLE_COUNTS 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+#endif
+
+using PythonVariableCounts = std::index_sequence<PYTHON_VARIABLE_COUNTS>;
 
-using PythonPolyRing = PolynomialRing<double, 3>;
-using PythonOrdering = LexOrder;
-//using PythonOrdering = GrevlexOrder;
+// The ring of the polynomials of a handle, chosen when the handle is created.
+struct RingDescriptor
+{
+   unsigned int variables = 3;
+   OrderingId ordering = OrderingId::Lex;
+   CoefficientDomainId domain = CoefficientDomainId::Real;
+};
+
+template<typename Field, size_t VARIABLES>
+using PythonPolyRing = std::conditional_t<std::is_floating_point<Field>::value,
+                                          PolynomialRing<double, VARIABLES>,
+                                          PrimeFieldRing<PYTHON_PRIME, VARIABLES>>;
+
+
+// The pool of the library's threads (created on the first use).
+inline ThreadPool& sharedThreadPool()
+{
+   static ThreadPool pool;
+   return pool;
+}
+
+// Held while a batch runs on the shared pool: ctypes releases the GIL during calls, so handles may be used
+// from several Python threads at once (and a pool runs one batch at a time).
+inline std::mutex& sharedThreadPoolMutex()
+{
+   static std::mutex mutex;
+   return mutex;
+}
 
 
 template<typename Ctor, size_t... S>
@@ -32,50 +89,327 @@ std::array<std::result_of_t<Ctor(size_t)>, N> makeArray(Ctor&& ctor)
 // Import / Export
 //////////////////////////////////////////////////////////////////////////
 
+// The types of the coefficients of a PolynomialBuffer.
+enum class CoefficientTypeId : unsigned int
+{
+   Double = 0,
+   Residue = 1 // uint32_t, for modular rings (the views of modular rings have residues).
+};
+
+// Polynomials cross the C interface in storage that is not copied: arrays owned by the caller (in), or
+// the storage of a polynomial held by a handle (out, a view that is valid until the handle changes).
+// Row i has the coefficient at coeffs+i*coeffs_stride, and the powers of the variables of the ring at
+// powers+i*powers_stride (strides are in bytes, as NumPy's). The rows may come in any order.
+struct PolynomialBuffer
+{
+   unsigned int terms;
+   void const *coeffs;
+   unsigned int coeffs_type; // CoefficientTypeId
+   size_t coeffs_stride;
+   unsigned int const *powers;
+   size_t powers_stride;
+};
+
+// A buffer of the contiguous arrays of the first C interface (double coefficients, rows of variables powers).
+inline PolynomialBuffer denseBuffer(unsigned int variables, unsigned int terms, double const * const coeffs, unsigned int const * const powers)
+{
+   return PolynomialBuffer {terms, coeffs, static_cast<unsigned int>(CoefficientTypeId::Double), sizeof(double), powers, variables*sizeof(unsigned int)};
+}
 
+template<typename Coefficient>
+Coefficient importCoefficient(double c)
+{
+   if constexpr (std::is_floating_point<Coefficient>::value) return c;
+   else return Coefficient(std::llround(c));
+}
+
+template<typename Coefficient>
+double exportCoefficient(Coefficient const &c)
+{
+   if constexpr (std::is_floating_point<Coefficient>::value) return c;
+   else return double(c.value());
+}
+
+// Reads the rows in a single pass, and sorts them once unless they are sorted already (e.g. exported polynomials).
+// The powers beyond variables (up to PolyRing::VARIABLES) are zero.
 template<typename PolyRing, class MonomialOrdering>
-Polynomial<PolyRing, MonomialOrdering> importPolynomial(unsigned int terms, double const * const coeffs, unsigned int const * const powers)
+Polynomial<PolyRing, MonomialOrdering> importPolynomial(unsigned int variables, PolynomialBuffer const &buffer)
 {
-   Polynomial<PolyRing, PythonOrdering> p;
-   for (unsigned int i = 0; i < terms; ++i) {
-      p += Term<PolyRing>(coeffs[i], makeArray<PolyRing::VARIABLES>([i, powers](size_t j){return powers[i*PolyRing::VARIABLES+j];}));
-   }
-   return p;
+   using Coefficient = typename PolyRing::Coefficient;
+   auto coeffs = static_cast<char const*>(buffer.coeffs);
+   auto powers = reinterpret_cast<char const*>(buffer.powers);
+   return Polynomial<PolyRing, MonomialOrdering>::fromTerms(buffer.terms,
+      [&buffer, coeffs](size_t i) {
+         if (buffer.coeffs_type == static_cast<unsigned int>(CoefficientTypeId::Residue))
+            return importCoefficient<Coefficient>(*reinterpret_cast<uint32_t const*>(coeffs+i*buffer.coeffs_stride));
+         return importCoefficient<Coefficient>(*reinterpret_cast<double const*>(coeffs+i*buffer.coeffs_stride));
+      },
+      [&buffer, powers, variables](size_t i) {
+         auto row = reinterpret_cast<unsigned int const*>(powers+i*buffer.powers_stride);
+         Monomial<PolyRing> monomial;
+         for (unsigned int j = 0; j < variables; ++j)
+            monomial.set(j, row[j]);
+         return monomial;
+      });
 }
 
+// A view of the storage of a polynomial: the coefficients are doubles or (modulo a 32-bit prime) residues,
+// and the rows of the powers are the (dense) exponents of the monomials.
 template<typename PolyRing, class MonomialOrdering>
-unsigned int exportPolynomial(Polynomial<PolyRing, MonomialOrdering> polynomial, double * out_coeffs, unsigned int * out_powers)
+PolynomialBuffer viewPolynomial(Polynomial<PolyRing, MonomialOrdering> const &polynomial)
 {
-   for (unsigned int i = 0; i < polynomial.terms(); ++i)
+   using Coefficient = typename PolyRing::Coefficient;
+   static_assert(std::is_floating_point<Coefficient>::value ||
+                 ((sizeof(Coefficient) == sizeof(uint32_t)) && std::is_standard_layout<Coefficient>::value),
+                 "A view has double or 32-bit residue coefficients");
+   PolynomialBuffer view;
+   view.terms = polynomial.terms();
+   view.coeffs = polynomial.coefficients();
+   view.coeffs_type = static_cast<unsigned int>(std::is_floating_point<Coefficient>::value ? CoefficientTypeId::Double : CoefficientTypeId::Residue);
+   view.coeffs_stride = sizeof(Coefficient);
+   view.powers = (polynomial.terms() == 0) ? nullptr : polynomial.monomials()[0].exponents().powers();
+   view.powers_stride = sizeof(Monomial<PolyRing>);
+   return view;
+}
+
+// Copies a view into the contiguous arrays of the first C interface. Returns the number of terms.
+inline unsigned int exportPolynomial(unsigned int variables, PolynomialBuffer const &view, double * out_coeffs, unsigned int * out_powers)
+{
+   auto coeffs = static_cast<char const*>(view.coeffs);
+   auto powers = reinterpret_cast<char const*>(view.powers);
+   for (unsigned int i = 0; i < view.terms; ++i)
    {
-      out_coeffs[i] = polynomial[i].getCoeff();
-      auto& monomial = polynomial[i].getMonomial();
-      for (unsigned int j = 0; j < PolyRing::VARIABLES; ++j) {
-         out_powers[PolyRing::VARIABLES*i+j] = monomial[j];
-      }
+      if (view.coeffs_type == static_cast<unsigned int>(CoefficientTypeId::Residue))
+         out_coeffs[i] = *reinterpret_cast<uint32_t const*>(coeffs+i*view.coeffs_stride);
+      else
+         out_coeffs[i] = *reinterpret_cast<double const*>(coeffs+i*view.coeffs_stride);
+      std::memcpy(out_powers+i*variables, powers+i*view.powers_stride, variables*sizeof(unsigned int));
+   }
+   return view.terms;
+}
+
+
+// Operations
+//////////////////////////////////////////////////////////////////////////
+
+// The C interface holds the operations through these interfaces, so the handles of all the rings are alike.
+// Polynomials are passed in PolynomialBuffers, and results are returned as views of the handle's storage.
+
+class Operation
+{
+public:
+   explicit Operation(unsigned int variables) : m_variables(variables) {}
+   virtual ~Operation() {}
+
+   unsigned int variables() const {return m_variables;}
+
+protected:
+   unsigned int m_variables;
+};
+
+class SparseMultiplicationOperation : public Operation
+{
+public:
+   using Operation::Operation;
+   virtual void addMultiplicand(PolynomialBuffer const &multiplicand) = 0;
+   virtual PolynomialBuffer result() = 0;
+};
+
+class DivisionOperation : public Operation
+{
+public:
+   using Operation::Operation;
+   virtual void addDivisor(PolynomialBuffer const &divisor) = 0;
+   virtual void calculate() = 0;
+   virtual size_t quotients() = 0;
+   virtual PolynomialBuffer quotient(size_t i) = 0;
+   virtual PolynomialBuffer remainder() = 0;
+};
+
+class AdditionOperation : public Operation
+{
+public:
+   using Operation::Operation;
+   virtual void addSummand(PolynomialBuffer const &summand) = 0;
+   virtual PolynomialBuffer result() = 0;
+};
+
+class SubtractionOperation : public Operation
+{
+public:
+   using Operation::Operation;
+   virtual PolynomialBuffer result() = 0;
+};
+
+// Pair selection strategies (as passed through the C interface).
+enum class SelectionStrategyId : unsigned int
+{
+   Normal = 0,
+   Sugar = 1,
+   FirstPair = 2
+};
+
+// Algorithms (as passed through the C interface).
+enum class GroebnerAlgorithmId : unsigned int
+{
+   Buchberger = 0,
+   Signature = 1 // runSignatureBuchbergers (the strategy does not apply).
+};
+
+// A Groebner basis of generators, by the algorithm (and pair selection strategy). The monitor applies to
+// Buchberger's algorithm only.
+template<typename PolynomialType>
+std::deque<PolynomialType> computeGroebner(std::deque<PolynomialType> const &generators, GroebnerAlgorithmId algorithm,
+                                           SelectionStrategyId strategy, BuchbergerStatistics *statistics,
+                                           BuchbergerMonitor *monitor=nullptr)
+{
+   if (algorithm == GroebnerAlgorithmId::Signature) return runSignatureBuchbergers(generators, statistics);
+   switch (strategy)
+   {
+      case SelectionStrategyId::Sugar: return runBuchbergers<SugarStrategy>(generators, statistics, nullptr, monitor);
+      case SelectionStrategyId::FirstPair: return runBuchbergers<FirstPairStrategy>(generators, statistics, nullptr, monitor);
+      default: return runBuchbergers<NormalStrategy>(generators, statistics, nullptr, monitor);
+   }
+}
+
+class BuchbergersOperation : public Operation
+{
+public:
+   using Operation::Operation;
+   virtual void setStrategy(SelectionStrategyId strategy) = 0;
+   virtual void setAlgorithm(GroebnerAlgorithmId algorithm) = 0;
+   virtual BuchbergerStatistics const& statistics() = 0;
+   virtual size_t generators() = 0;
+   virtual void addIdealGenerator(PolynomialBuffer const &generator) = 0;
+   virtual void calculate() = 0;
+   virtual void reduce() = 0;
+   virtual void minimize() = 0;
+   virtual size_t basisSize() = 0;
+   virtual PolynomialBuffer basisElement(size_t i) = 0;
+};
+
+// States of a job (as passed through the C interface).
+enum class JobStateId : unsigned int
+{
+   Idle = 0,      // Not started.
+   Running = 1,
+   Completed = 2, // The basis is a Groebner basis.
+   Cancelled = 3, // The basis is partial (see BuchbergerMonitor), as when a limit was reached:
+   TimedOut = 4,
+   OutOfMemory = 5
+};
+
+struct GroebnerJobProgress
+{
+   unsigned int state; // JobStateId
+   unsigned int degree; // The total degree of the latest pair.
+   unsigned long long basis_size;
+   unsigned long long pairs_remaining;
+   unsigned long long memory; // The bytes of the polynomials of the run.
+};
+
+// A Groebner basis (by Buchberger's algorithm), computed on a thread of its own while the caller polls its
+// progress. The run stops early when cancelled, or at its wall-time or memory limit, with a partial basis.
+class GroebnerJobOperation : public Operation
+{
+public:
+   using Operation::Operation;
+   virtual void addIdealGenerator(PolynomialBuffer const &generator) = 0; // Before start().
+   // Starts the run (once). A limit of 0 is unbounded. The basis is reduced only if the run completes.
+   virtual void start(SelectionStrategyId strategy, bool reduce, double seconds, size_t memory) = 0;
+   virtual void cancel() = 0;
+   virtual GroebnerJobProgress progress() = 0;
+   // Waits for the run to end, up to seconds (or with no bound, if negative). Returns the state.
+   virtual JobStateId wait(double seconds) = 0;
+   virtual size_t basisSize() = 0; // 0 until the run ends.
+   virtual PolynomialBuffer basisElement(size_t i) = 0;
+};
+
+// Many independent problems, packed in flat arrays: problem b has the polynomials [problem_offsets[b], problem_offsets[b+1]),
+// and polynomial p has the rows [polynomial_offsets[p], polynomial_offsets[p+1]) of coeffs and powers (contiguous, with
+// the coefficients of coeffs_type, and rows of the ring's variables powers). The results of a batch are packed alike.
+struct PackedPolynomials
+{
+   unsigned int problems;
+   unsigned int const *problem_offsets;    // problems+1 offsets.
+   unsigned int const *polynomial_offsets; // problem_offsets[problems]+1 offsets.
+   void const *coeffs;
+   unsigned int coeffs_type; // CoefficientTypeId
+   unsigned int const *powers;
+};
+
+// Solves the problems of a batch on the shared pool. The results are held by the handle (and viewed).
+class BatchOperation : public Operation
+{
+public:
+   using Operation::Operation;
+   virtual void calculate(PackedPolynomials const &problems) = 0;
+   virtual PackedPolynomials result() = 0;
+};
+
+
+// The operations over one ring (the kernels of its instantiation).
+class RingKernels
+{
+public:
+   virtual ~RingKernels() {}
+   virtual SparseMultiplicationOperation* sparseMultiplication() const = 0;
+   virtual DivisionOperation* division(PolynomialBuffer const &dividend) const = 0;
+   virtual AdditionOperation* addition() const = 0;
+   virtual SubtractionOperation* subtraction(PolynomialBuffer const &minuend, PolynomialBuffer const &subtrahend) const = 0;
+   virtual BuchbergersOperation* buchbergers() const = 0;
+
+   // Problems of (dividend, divisors...), with results of (remainder, quotients...).
+   virtual BatchOperation* divisionBatch() const = 0;
+   // Problems of (generators...), with results of (the basis...).
+   virtual BatchOperation* groebnerBatch(GroebnerAlgorithmId algorithm, SelectionStrategyId strategy, bool reduce) const = 0;
+
+   virtual GroebnerJobOperation* groebnerJob() const = 0;
+};
+
+// The kernels of the rings of an ordering over (variables, domain), or null if no kernel fits the variables.
+// Instantiated once per ordering (see kernels.h), so the orderings are compiled separately.
+template<typename MonomialOrdering>
+std::unique_ptr<RingKernels> makeRingKernels(unsigned int variables, CoefficientDomainId domain);
+
+extern template std::unique_ptr<RingKernels> makeRingKernels<LexOrder>(unsigned int, CoefficientDomainId);
+extern template std::unique_ptr<RingKernels> makeRingKernels<GrlexOrder>(unsigned int, CoefficientDomainId);
+extern template std::unique_ptr<RingKernels> makeRingKernels<GrevlexOrder>(unsigned int, CoefficientDomainId);
+
+inline std::unique_ptr<RingKernels> makeRingKernels(RingDescriptor ring)
+{
+   switch (ring.ordering)
+   {
+      case OrderingId::Lex: return makeRingKernels<LexOrder>(ring.variables, ring.domain);
+      case OrderingId::Grlex: return makeRingKernels<GrlexOrder>(ring.variables, ring.domain);
+      case OrderingId::Grevlex: return makeRingKernels<GrevlexOrder>(ring.variables, ring.domain);
+      default: return nullptr;
    }
-   return polynomial.terms();
 }
 
 
 // SparseMultiplication
 //////////////////////////////////////////////////////////////////////////
 template<typename PolyRing, class MonomialOrdering>
-class SparseMultiplication
+class SparseMultiplication : public SparseMultiplicationOperation
 {
 public:
-   void addMultiplicand(Polynomial<PolyRing, MonomialOrdering> multiplicand)
+   using SparseMultiplicationOperation::SparseMultiplicationOperation;
+
+   void addMultiplicand(PolynomialBuffer const &multiplicand) override
    {
+      auto polynomial = importPolynomial<PolyRing, MonomialOrdering>(m_variables, multiplicand);
       if (m_result.terms() == 0) {
-         m_result = multiplicand;
+         m_result = std::move(polynomial);
       } else {
-         m_result = m_result * multiplicand;
+         std::lock_guard<std::mutex> lock(sharedThreadPoolMutex());
+         m_result = multiplyParallel(m_result, polynomial, sharedThreadPool());
       }
    }
 
-   Polynomial<PolyRing, MonomialOrdering> result()
+   PolynomialBuffer result() override
    {
-      return m_result;
+      return viewPolynomial(m_result);
    }
 
 private:
@@ -86,35 +420,35 @@ private:
 // Division
 //////////////////////////////////////////////////////////////////////////
 template<typename PolyRing, class MonomialOrdering>
-class Division
+class Division : public DivisionOperation
 {
 public:
-   Division(Polynomial<PolyRing, MonomialOrdering> dividend)
-      : m_dividend(dividend) {}
+   Division(unsigned int variables, PolynomialBuffer const &dividend)
+      : DivisionOperation(variables), m_dividend(importPolynomial<PolyRing, MonomialOrdering>(variables, dividend)) {}
 
-   void addDivisor(Polynomial<PolyRing, MonomialOrdering> divisor)
+   void addDivisor(PolynomialBuffer const &divisor) override
    {
-      m_divisors.push_back(divisor);
+      m_divisors.push_back(importPolynomial<PolyRing, MonomialOrdering>(m_variables, divisor));
    }
 
-   void calculate()
+   void calculate() override
    {
       std::tie(m_remainder, m_quotients) = divide(m_dividend, m_divisors);
    }
 
-   size_t quotients()
+   size_t quotients() override
    {
       return m_quotients.size();
    }
 
-   Polynomial<PolyRing, MonomialOrdering> quotient(size_t i)
+   PolynomialBuffer quotient(size_t i) override
    {
-      return m_quotients[i];
+      return viewPolynomial(m_quotients[i]);
    }
 
-   Polynomial<PolyRing, MonomialOrdering> remainder()
+   PolynomialBuffer remainder() override
    {
-      return m_remainder;
+      return viewPolynomial(m_remainder);
    }
 
 private:
@@ -129,36 +463,49 @@ private:
 // Addition
 //////////////////////////////////////////////////////////////////////////
 template<typename PolyRing, class MonomialOrdering>
-class Addition
+class Addition : public AdditionOperation
 {
 public:
-   void addSummand(Polynomial<PolyRing, MonomialOrdering> summand)
+   using AdditionOperation::AdditionOperation;
+
+   void addSummand(PolynomialBuffer const &summand) override
    {
-      m_result += summand;
+      m_sum += importPolynomial<PolyRing, MonomialOrdering>(m_variables, summand);
+      m_summed = false;
    }
 
-   Polynomial<PolyRing, MonomialOrdering> result()
+   PolynomialBuffer result() override
    {
-      return m_result;
+      // The sum is kept for the views (and summed again only after more summands).
+      if (!m_summed) {
+         m_result = m_sum.sum();
+         m_summed = true;
+      }
+      return viewPolynomial(m_result);
    }
 
 private:
+   Geobucket<Polynomial<PolyRing, MonomialOrdering>> m_sum;
    Polynomial<PolyRing, MonomialOrdering> m_result;
+   bool m_summed = true;
 }; // Addition
 
 
 // Subtraction
 //////////////////////////////////////////////////////////////////////////
 template<typename PolyRing, class MonomialOrdering>
-class Subtraction
+class Subtraction : public SubtractionOperation
 {
 public:
-   Subtraction(Polynomial<PolyRing, MonomialOrdering> minuend, Polynomial<PolyRing, MonomialOrdering> subtrahend)
-      : m_result(minuend) {m_result -= subtrahend;}
+   Subtraction(unsigned int variables, PolynomialBuffer const &minuend, PolynomialBuffer const &subtrahend)
+      : SubtractionOperation(variables), m_result(importPolynomial<PolyRing, MonomialOrdering>(variables, minuend))
+   {
+      m_result -= importPolynomial<PolyRing, MonomialOrdering>(variables, subtrahend);
+   }
 
-   Polynomial<PolyRing, MonomialOrdering> result()
+   PolynomialBuffer result() override
    {
-      return m_result;
+      return viewPolynomial(m_result);
    }
 
 private:
@@ -171,28 +518,44 @@ private:
 // Buchbergers
 //////////////////////////////////////////////////////////////////////////
 template<typename PolyRing, class MonomialOrdering>
-class Buchbergers
+class Buchbergers : public BuchbergersOperation
 {
 public:
-   Buchbergers() : m_minimal(false) {}
+   explicit Buchbergers(unsigned int variables)
+      : BuchbergersOperation(variables), m_minimal(false), m_strategy(SelectionStrategyId::Normal), m_algorithm(GroebnerAlgorithmId::Buchberger) {}
 
-   size_t generators()
+   void setStrategy(SelectionStrategyId strategy) override
+   {
+      m_strategy = strategy;
+   }
+
+   void setAlgorithm(GroebnerAlgorithmId algorithm) override
+   {
+      m_algorithm = algorithm;
+   }
+
+   BuchbergerStatistics const& statistics() override
+   {
+      return m_statistics;
+   }
+
+   size_t generators() override
    {
       return m_ideal_generators.size();
    }
 
-   void addIdealGenerator(Polynomial<PolyRing, MonomialOrdering> polynomial)
+   void addIdealGenerator(PolynomialBuffer const &generator) override
    {
-      m_ideal_generators.push_back(polynomial);
+      m_ideal_generators.push_back(importPolynomial<PolyRing, MonomialOrdering>(m_variables, generator));
    }
 
-   void calculate()
+   void calculate() override
    {
       m_minimal = false;
-      m_groebner = runBuchbergers(m_ideal_generators);
+      m_groebner = computeGroebner(m_ideal_generators, m_algorithm, m_strategy, &m_statistics);
    }
 
-   void reduce()
+   void reduce() override
    {
       if (!m_minimal) {
          minimize();
@@ -200,28 +563,265 @@ public:
       makeReducedGroebner(m_groebner);
    }
 
-   void minimize()
+   void minimize() override
    {
       makeMinimalGroebner(m_groebner);
       m_minimal = true;
    }
 
-   size_t basisSize()
+   size_t basisSize() override
    {
       return m_groebner.size();
    }
 
-   Polynomial<PolyRing, MonomialOrdering> basisElement(size_t i)
+   PolynomialBuffer basisElement(size_t i) override
    {
-      return m_groebner[i];
+      return viewPolynomial(m_groebner[i]);
    }
 
 private:
    bool m_minimal;
+   SelectionStrategyId m_strategy;
+   GroebnerAlgorithmId m_algorithm;
+   BuchbergerStatistics m_statistics;
    std::deque<Polynomial<PolyRing, MonomialOrdering>> m_ideal_generators;
    std::deque<Polynomial<PolyRing, MonomialOrdering>> m_groebner;
 };
 
 
 
+// Batches
+//////////////////////////////////////////////////////////////////////////
+template<typename PolyRing, class MonomialOrdering>
+class Batch : public BatchOperation
+{
+public:
+   using PolynomialType = Polynomial<PolyRing, MonomialOrdering>;
+   using BatchOperation::BatchOperation;
+
+   void calculate(PackedPolynomials const &problems) override
+   {
+      m_results.assign(problems.problems, {});
+      std::lock_guard<std::mutex> lock(sharedThreadPoolMutex());
+      sharedThreadPool().run(problems.problems, [this, &problems](size_t b) {
+         std::deque<PolynomialType> polynomials;
+         for (unsigned int p = problems.problem_offsets[b]; p < problems.problem_offsets[b+1]; ++p)
+            polynomials.push_back(importPolynomial<PolyRing, MonomialOrdering>(m_variables, packedBuffer(problems, p)));
+         m_results[b] = solve(polynomials);
+      });
+      pack();
+   }
+
+   PackedPolynomials result() override
+   {
+      return PackedPolynomials {static_cast<unsigned int>(m_results.size()), m_problem_offsets.data(), m_polynomial_offsets.data(),
+                                m_coeffs.data(), static_cast<unsigned int>(COEFFICIENT_TYPE), m_powers.data()};
+   }
+
+protected:
+   virtual std::vector<PolynomialType> solve(std::deque<PolynomialType> const &polynomials) const = 0;
+
+private:
+   using PackedCoefficient = std::conditional_t<std::is_floating_point<typename PolyRing::Coefficient>::value, double, uint32_t>;
+   static const CoefficientTypeId COEFFICIENT_TYPE = std::is_floating_point<typename PolyRing::Coefficient>::value ? CoefficientTypeId::Double : CoefficientTypeId::Residue;
+
+   PolynomialBuffer packedBuffer(PackedPolynomials const &packed, unsigned int p) const
+   {
+      unsigned int begin = packed.polynomial_offsets[p];
+      size_t coeff_size = (packed.coeffs_type == static_cast<unsigned int>(CoefficientTypeId::Residue)) ? sizeof(uint32_t) : sizeof(double);
+      return PolynomialBuffer {packed.polynomial_offsets[p+1]-begin, static_cast<char const*>(packed.coeffs)+begin*coeff_size, packed.coeffs_type,
+                               coeff_size, packed.powers+size_t(begin)*m_variables, m_variables*sizeof(unsigned int)};
+   }
+
+   // The offsets are summed up first, and then every problem copies its results into its own place (on the pool).
+   void pack()
+   {
+      m_problem_offsets.assign(1, 0);
+      m_polynomial_offsets.assign(1, 0);
+      for (auto const &results: m_results)
+      {
+         for (auto const &polynomial: results)
+            m_polynomial_offsets.push_back(m_polynomial_offsets.back()+polynomial.terms());
+         m_problem_offsets.push_back(m_polynomial_offsets.size()-1);
+      }
+      m_coeffs.resize(m_polynomial_offsets.back());
+      m_powers.resize(size_t(m_polynomial_offsets.back())*m_variables);
+      sharedThreadPool().run(m_results.size(), [this](size_t b) {
+         for (size_t i = 0; i < m_results[b].size(); ++i)
+         {
+            auto const &polynomial = m_results[b][i];
+            size_t row = m_polynomial_offsets[m_problem_offsets[b]+i];
+            for (size_t t = 0; t < polynomial.terms(); ++t, ++row)
+            {
+               if constexpr (std::is_floating_point<typename PolyRing::Coefficient>::value) m_coeffs[row] = polynomial.getCoeff(t);
+               else m_coeffs[row] = PackedCoefficient(polynomial.getCoeff(t).value());
+               std::copy_n(polynomial.getMonomial(t).exponents().powers(), m_variables, m_powers.data()+row*m_variables);
+            }
+         }
+         m_results[b].clear();
+      });
+   }
+
+private:
+   std::vector<std::vector<PolynomialType>> m_results;
+   std::vector<unsigned int> m_problem_offsets = {0};
+   std::vector<unsigned int> m_polynomial_offsets = {0};
+   std::vector<PackedCoefficient> m_coeffs;
+   std::vector<unsigned int> m_powers;
+};
+
+
+template<typename PolyRing, class MonomialOrdering>
+class DivisionBatch : public Batch<PolyRing, MonomialOrdering>
+{
+public:
+   using PolynomialType = Polynomial<PolyRing, MonomialOrdering>;
+   using Batch<PolyRing, MonomialOrdering>::Batch;
+
+protected:
+   std::vector<PolynomialType> solve(std::deque<PolynomialType> const &polynomials) const override
+   {
+      if (polynomials.empty()) return {};
+      std::deque<PolynomialType> divisors(polynomials.begin()+1, polynomials.end());
+      PolynomialType remainder;
+      std::vector<PolynomialType> quotients;
+      std::tie(remainder, quotients) = divide(polynomials.front(), divisors);
+      quotients.insert(quotients.begin(), std::move(remainder));
+      return quotients;
+   }
+};
+
+
+template<typename PolyRing, class MonomialOrdering>
+class GroebnerBatch : public Batch<PolyRing, MonomialOrdering>
+{
+public:
+   using PolynomialType = Polynomial<PolyRing, MonomialOrdering>;
+
+   GroebnerBatch(unsigned int variables, GroebnerAlgorithmId algorithm, SelectionStrategyId strategy, bool reduce)
+      : Batch<PolyRing, MonomialOrdering>(variables), m_algorithm(algorithm), m_strategy(strategy), m_reduce(reduce) {}
+
+protected:
+   std::vector<PolynomialType> solve(std::deque<PolynomialType> const &polynomials) const override
+   {
+      auto groebner = computeGroebner(polynomials, m_algorithm, m_strategy, nullptr);
+      if (m_reduce)
+      {
+         makeMinimalGroebner(groebner);
+         makeReducedGroebner(groebner);
+      }
+      return std::vector<PolynomialType>(std::make_move_iterator(groebner.begin()), std::make_move_iterator(groebner.end()));
+   }
+
+private:
+   GroebnerAlgorithmId m_algorithm;
+   SelectionStrategyId m_strategy;
+   bool m_reduce;
+};
+
+
+
+// Groebner jobs
+//////////////////////////////////////////////////////////////////////////
+template<typename PolyRing, class MonomialOrdering>
+class GroebnerJob : public GroebnerJobOperation
+{
+public:
+   using PolynomialType = Polynomial<PolyRing, MonomialOrdering>;
+
+   explicit GroebnerJob(unsigned int variables) : GroebnerJobOperation(variables), m_state(JobStateId::Idle) {}
+
+   ~GroebnerJob() override
+   {
+      m_monitor.cancel();
+      if (m_thread.joinable()) m_thread.join();
+   }
+
+   void addIdealGenerator(PolynomialBuffer const &generator) override
+   {
+      if (m_state == JobStateId::Idle)
+         m_ideal_generators.push_back(importPolynomial<PolyRing, MonomialOrdering>(m_variables, generator));
+   }
+
+   void start(SelectionStrategyId strategy, bool reduce, double seconds, size_t memory) override
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_state != JobStateId::Idle) return;
+      if (seconds > 0)
+         m_monitor.deadline = std::chrono::steady_clock::now() +
+                              std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+      if (memory > 0) m_monitor.memory_limit = memory;
+      m_monitor.memory = &m_memory;
+      m_state = JobStateId::Running;
+      m_thread = std::thread([this, strategy, reduce] {run(strategy, reduce);});
+   }
+
+   void cancel() override
+   {
+      m_monitor.cancel();
+   }
+
+   GroebnerJobProgress progress() override
+   {
+      return {static_cast<unsigned int>(m_state.load()), m_monitor.degree, m_monitor.basis_size, m_monitor.pairs_remaining, m_memory.bytes()};
+   }
+
+   JobStateId wait(double seconds) override
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      auto ended = [this] {return m_state != JobStateId::Running;};
+      if (seconds < 0) m_ended.wait(lock, ended);
+      else m_ended.wait_for(lock, std::chrono::duration<double>(seconds), ended);
+      return m_state;
+   }
+
+   size_t basisSize() override
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return (m_state == JobStateId::Running) ? 0 : m_groebner.size();
+   }
+
+   PolynomialBuffer basisElement(size_t i) override
+   {
+      return viewPolynomial(m_groebner[i]);
+   }
+
+private:
+   void run(SelectionStrategyId strategy, bool reduce)
+   {
+      // All the polynomials of the run (its arena, and the basis) are allocated from the metered resource.
+      currentPolynomialResource() = &m_memory;
+      auto groebner = computeGroebner(m_ideal_generators, GroebnerAlgorithmId::Buchberger, strategy, nullptr, &m_monitor);
+      auto stopped = m_monitor.stopped();
+      if ((stopped == BuchbergerMonitor::Stop::None) && reduce)
+      {
+         makeMinimalGroebner(groebner);
+         makeReducedGroebner(groebner);
+      }
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_groebner = std::move(groebner);
+      switch (stopped)
+      {
+         case BuchbergerMonitor::Stop::Cancelled: m_state = JobStateId::Cancelled; break;
+         case BuchbergerMonitor::Stop::Deadline: m_state = JobStateId::TimedOut; break;
+         case BuchbergerMonitor::Stop::Memory: m_state = JobStateId::OutOfMemory; break;
+         default: m_state = JobStateId::Completed; break;
+      }
+      m_ended.notify_all();
+   }
+
+private:
+   MeteredResource m_memory; // Outlives the polynomials below.
+   std::deque<PolynomialType> m_ideal_generators;
+   std::deque<PolynomialType> m_groebner;
+   BuchbergerMonitor m_monitor;
+   std::atomic<JobStateId> m_state;
+   std::mutex m_mutex;
+   std::condition_variable m_ended;
+   std::thread m_thread;
+};
+
+
+
 #endif
@@ -0,0 +1,655 @@
+// rationals.h
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Exact coefficients over Q.
+// (1) BigInteger - An integer of arbitrary size. Values that fit a machine word are stored inline
+//                  (and operated on by overflow-checked native arithmetic), and only the results
+//                  that overflow spill to heap-allocated magnitudes (32-bit limbs).
+// (2) Rational   - A reduced fraction of BigIntegers (the denominator is positive).
+// (3) RationalRing<N> - A PolyRing policy for Q[x1, ..., xn]. Rational provides gcd (the content
+//                  of two coefficients), so polynomials over Q support makePrimitive().
+///////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+#ifndef rationals_H__
+#define rationals_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <ostream>
+#include <utility>
+#include <algorithm>
+
+#include "exponents.h"
+
+
+// ** class BigInteger
+////////////////////////////////////////////////////////////////////////////
+class BigInteger
+{
+public:
+   BigInteger(long long v = 0);
+
+   bool isSmall() const; // The value is stored inline.
+   bool isZero() const;
+   int sign() const; // -1, 0 or 1
+   std::string toString() const;
+   double toDouble() const;
+   uint64_t residue(uint64_t m) const; // The non-negative remainder modulo m (0 < m < 2^63).
+
+   BigInteger operator-() const;
+   BigInteger& operator+=(BigInteger const &other);
+   BigInteger& operator-=(BigInteger const &other);
+   BigInteger& operator*=(BigInteger const &other);
+   BigInteger& operator/=(BigInteger const &other); // Truncated.
+   BigInteger& operator%=(BigInteger const &other); // The sign of the dividend.
+
+   bool operator==(BigInteger const &other) const;
+   bool operator!=(BigInteger const &other) const;
+   bool operator<(BigInteger const &other) const;
+
+   friend BigInteger gcd(BigInteger a, BigInteger b); // Non-negative.
+   friend void divideWithRemainder(BigInteger const &a, BigInteger const &b, BigInteger &quotient, BigInteger &remainder);
+
+private:
+   using Limbs = std::vector<uint32_t>; // Little endian magnitude.
+
+   static BigInteger fromMagnitude(bool negative, Limbs magnitude);
+   bool negative() const;
+   Limbs magnitude() const;
+
+   static void trim(Limbs &a);
+   static int compareMagnitudes(Limbs const &a, Limbs const &b);
+   static Limbs addMagnitudes(Limbs const &a, Limbs const &b);
+   static Limbs subtractMagnitudes(Limbs const &a, Limbs const &b); // Assumes a >= b.
+   static Limbs multiplyMagnitudes(Limbs const &a, Limbs const &b);
+   static void divideMagnitudes(Limbs const &a, Limbs const &b, Limbs &quotient, Limbs &remainder);
+
+private:
+   int64_t m_small;  // The value, when m_limbs is empty.
+   bool m_negative;  // The sign, when m_limbs is not empty.
+   Limbs m_limbs;    // The magnitude of values that do not fit m_small.
+};
+
+BigInteger gcd(BigInteger a, BigInteger b);
+void divideWithRemainder(BigInteger const &a, BigInteger const &b, BigInteger &quotient, BigInteger &remainder);
+BigInteger operator+(BigInteger a, BigInteger const &b);
+BigInteger operator-(BigInteger a, BigInteger const &b);
+BigInteger operator*(BigInteger a, BigInteger const &b);
+BigInteger operator/(BigInteger a, BigInteger const &b);
+BigInteger operator%(BigInteger a, BigInteger const &b);
+std::ostream& operator<<(std::ostream &out, BigInteger const &a);
+
+
+// ** class Rational
+////////////////////////////////////////////////////////////////////////////
+class Rational
+{
+public:
+   Rational(long long numerator = 0);
+   Rational(BigInteger numerator, BigInteger denominator = 1);
+
+   BigInteger const& numerator() const;
+   BigInteger const& denominator() const;
+   bool isZero() const;
+   bool isInteger() const;
+   std::string toString() const;
+
+   Rational operator-() const;
+   Rational& operator+=(Rational const &other);
+   Rational& operator-=(Rational const &other);
+   Rational& operator*=(Rational const &other);
+   Rational& operator/=(Rational const &other);
+
+   bool operator==(Rational const &other) const;
+   bool operator!=(Rational const &other) const;
+
+   // The content of two coefficients: gcd of the numerators over lcm of the denominators.
+   static Rational gcd(Rational const &a, Rational const &b);
+
+private:
+   void reduce();
+
+private:
+   BigInteger m_numerator;
+   BigInteger m_denominator;
+};
+
+Rational operator+(Rational a, Rational const &b);
+Rational operator-(Rational a, Rational const &b);
+Rational operator*(Rational a, Rational const &b);
+Rational operator/(Rational a, Rational const &b);
+std::ostream& operator<<(std::ostream &out, Rational const &a);
+
+
+// ** struct RationalRing
+// A policy for Q[x_1, x_2, ..., x_n].
+template<size_t VARIABLES_COUNT, typename ExponentsType=DenseExponents<VARIABLES_COUNT>>
+struct RationalRing
+{
+   using Coefficient = Rational;
+   static const size_t VARIABLES = VARIABLES_COUNT;
+   using Exponents = ExponentsType;
+   static bool isZero(Coefficient const &a) {return a.isZero();}
+};
+
+
+
+// BigInteger - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+inline BigInteger::BigInteger(long long v)
+   : m_small(v), m_negative(false)
+{
+}
+
+inline bool BigInteger::isSmall() const
+{
+   return m_limbs.empty();
+}
+
+inline bool BigInteger::isZero() const
+{
+   return isSmall() && (m_small == 0);
+}
+
+inline int BigInteger::sign() const
+{
+   if (isSmall()) return (m_small > 0)-(m_small < 0);
+   return m_negative ? -1 : 1;
+}
+
+inline bool BigInteger::negative() const
+{
+   return isSmall() ? (m_small < 0) : m_negative;
+}
+
+inline BigInteger::Limbs BigInteger::magnitude() const
+{
+   if (!isSmall()) return m_limbs;
+   uint64_t m = (m_small < 0) ? uint64_t(0)-uint64_t(m_small) : uint64_t(m_small);
+   Limbs res;
+   for (; m != 0; m >>= 32)
+      res.push_back(uint32_t(m));
+   return res;
+}
+
+inline BigInteger BigInteger::fromMagnitude(bool negative, Limbs magnitude)
+{
+   trim(magnitude);
+   BigInteger res;
+   if (magnitude.size() <= 2)
+   {
+      uint64_t m = 0;
+      for (size_t i = magnitude.size(); i-- > 0;)
+         m = (m << 32) | magnitude[i];
+      if (!negative && (m <= uint64_t(INT64_MAX)))
+      {
+         res.m_small = int64_t(m);
+         return res;
+      }
+      if (negative && (m <= uint64_t(INT64_MAX)+1))
+      {
+         res.m_small = int64_t(uint64_t(0)-m);
+         return res;
+      }
+   }
+   res.m_small = 0;
+   res.m_negative = negative;
+   res.m_limbs = std::move(magnitude);
+   return res;
+}
+
+inline void BigInteger::trim(Limbs &a)
+{
+   while (!a.empty() && (a.back() == 0))
+      a.pop_back();
+}
+
+inline int BigInteger::compareMagnitudes(Limbs const &a, Limbs const &b)
+{
+   if (a.size() != b.size()) return (a.size() < b.size()) ? -1 : 1;
+   for (size_t i = a.size(); i-- > 0;)
+      if (a[i] != b[i]) return (a[i] < b[i]) ? -1 : 1;
+   return 0;
+}
+
+inline BigInteger::Limbs BigInteger::addMagnitudes(Limbs const &a, Limbs const &b)
+{
+   Limbs res(std::max(a.size(), b.size())+1, 0);
+   uint64_t carry = 0;
+   for (size_t i = 0; i+1 < res.size(); ++i)
+   {
+      uint64_t s = carry+(i < a.size() ? a[i] : 0)+(i < b.size() ? b[i] : 0);
+      res[i] = uint32_t(s);
+      carry = s >> 32;
+   }
+   res.back() = uint32_t(carry);
+   trim(res);
+   return res;
+}
+
+inline BigInteger::Limbs BigInteger::subtractMagnitudes(Limbs const &a, Limbs const &b)
+{
+   Limbs res(a.size(), 0);
+   int64_t borrow = 0;
+   for (size_t i = 0; i < a.size(); ++i)
+   {
+      int64_t d = int64_t(a[i])-(i < b.size() ? b[i] : 0)-borrow;
+      borrow = (d < 0);
+      res[i] = uint32_t(d+(borrow << 32));
+   }
+   trim(res);
+   return res;
+}
+
+inline BigInteger::Limbs BigInteger::multiplyMagnitudes(Limbs const &a, Limbs const &b)
+{
+   if (a.empty() || b.empty()) return Limbs();
+   Limbs res(a.size()+b.size(), 0);
+   for (size_t i = 0; i < a.size(); ++i)
+   {
+      uint64_t carry = 0;
+      for (size_t j = 0; j < b.size(); ++j)
+      {
+         uint64_t t = uint64_t(a[i])*b[j]+res[i+j]+carry;
+         res[i+j] = uint32_t(t);
+         carry = t >> 32;
+      }
+      res[i+b.size()] = uint32_t(carry);
+   }
+   trim(res);
+   return res;
+}
+
+inline void BigInteger::divideMagnitudes(Limbs const &a, Limbs const &b, Limbs &quotient, Limbs &remainder)
+{
+   assert(!b.empty());
+   if (compareMagnitudes(a, b) < 0)
+   {
+      quotient.clear();
+      remainder = a;
+      return;
+   }
+   if (b.size() == 1)
+   {
+      quotient.assign(a.size(), 0);
+      uint64_t r = 0;
+      for (size_t i = a.size(); i-- > 0;)
+      {
+         uint64_t cur = (r << 32) | a[i];
+         quotient[i] = uint32_t(cur/b[0]);
+         r = cur%b[0];
+      }
+      trim(quotient);
+      remainder.assign(1, uint32_t(r));
+      trim(remainder);
+      return;
+   }
+
+   // Knuth's algorithm D: normalize so the top limb of the divisor has its high bit set.
+   const int shift = __builtin_clz(b.back());
+   auto shifted = [shift](Limbs const &x, size_t extra) {
+      Limbs res(x.size()+extra, 0);
+      for (size_t i = 0; i < x.size(); ++i)
+      {
+         uint64_t v = uint64_t(x[i]) << shift;
+         res[i] |= uint32_t(v);
+         if (i+1 < res.size()) res[i+1] |= uint32_t(v >> 32);
+      }
+      return res;
+   };
+   Limbs u = shifted(a, 1), v = shifted(b, 0);
+   const size_t n = v.size(), m = a.size()-b.size();
+   quotient.assign(m+1, 0);
+   for (size_t j = m+1; j-- > 0;)
+   {
+      uint64_t numerator = (uint64_t(u[j+n]) << 32) | u[j+n-1];
+      uint64_t qhat = numerator/v[n-1], rhat = numerator%v[n-1];
+      while ((qhat >> 32) || (qhat*v[n-2] > ((rhat << 32) | u[j+n-2])))
+      {
+         --qhat;
+         rhat += v[n-1];
+         if (rhat >> 32) break;
+      }
+      // u[j..j+n] -= qhat*v
+      int64_t borrow = 0;
+      uint64_t carry = 0;
+      for (size_t i = 0; i < n; ++i)
+      {
+         uint64_t p = qhat*v[i]+carry;
+         carry = p >> 32;
+         int64_t t = int64_t(u[i+j])-int64_t(uint32_t(p))-borrow;
+         borrow = (t < 0);
+         u[i+j] = uint32_t(t+(borrow << 32));
+      }
+      int64_t t = int64_t(u[j+n])-int64_t(carry)-borrow;
+      borrow = (t < 0);
+      u[j+n] = uint32_t(t+(borrow << 32));
+      if (borrow)
+      {
+         // qhat was one too large: add v back.
+         --qhat;
+         uint64_t c = 0;
+         for (size_t i = 0; i < n; ++i)
+         {
+            uint64_t s = uint64_t(u[i+j])+v[i]+c;
+            u[i+j] = uint32_t(s);
+            c = s >> 32;
+         }
+         u[j+n] = uint32_t(u[j+n]+c);
+      }
+      quotient[j] = uint32_t(qhat);
+   }
+   trim(quotient);
+
+   remainder.assign(n, 0);
+   for (size_t i = 0; i < n; ++i)
+      remainder[i] = uint32_t(((uint64_t(u[i]) | (uint64_t(u[i+1]) << 32)) >> shift));
+   trim(remainder);
+}
+
+inline std::string BigInteger::toString() const
+{
+   if (isSmall()) return std::to_string(m_small);
+   std::string digits;
+   Limbs m = m_limbs, q, r;
+   const Limbs billion {1000000000u};
+   while (!m.empty())
+   {
+      divideMagnitudes(m, billion, q, r);
+      std::string chunk = std::to_string(r.empty() ? 0 : r[0]);
+      if (!q.empty()) chunk = std::string(9-chunk.size(), '0')+chunk;
+      digits = chunk+digits;
+      m = q;
+   }
+   return (m_negative ? "-" : "")+digits;
+}
+
+inline double BigInteger::toDouble() const
+{
+   if (isSmall()) return double(m_small);
+   double res = 0;
+   for (size_t i = m_limbs.size(); i-- > 0;)
+      res = res*4294967296.0+m_limbs[i];
+   return m_negative ? -res : res;
+}
+
+inline uint64_t BigInteger::residue(uint64_t m) const
+{
+   assert((m > 0) && (m < (uint64_t(1) << 63)));
+   if (isSmall())
+   {
+      int64_t r = m_small%int64_t(m);
+      return uint64_t((r < 0) ? r+int64_t(m) : r);
+   }
+   uint64_t r = 0;
+   for (size_t i = m_limbs.size(); i-- > 0;)
+      r = uint64_t((((unsigned __int128)r << 32) | m_limbs[i])%m);
+   return (m_negative && (r != 0)) ? m-r : r;
+}
+
+inline BigInteger BigInteger::operator-() const
+{
+   if (isSmall() && (m_small != INT64_MIN))
+      return BigInteger(-m_small);
+   return fromMagnitude(!negative(), magnitude());
+}
+
+inline BigInteger& BigInteger::operator+=(BigInteger const &other)
+{
+   int64_t s;
+   if (isSmall() && other.isSmall() && !__builtin_add_overflow(m_small, other.m_small, &s))
+   {
+      m_small = s;
+      return *this;
+   }
+   Limbs a = magnitude(), b = other.magnitude();
+   if (negative() == other.negative())
+      *this = fromMagnitude(negative(), addMagnitudes(a, b));
+   else if (compareMagnitudes(a, b) >= 0)
+      *this = fromMagnitude(negative(), subtractMagnitudes(a, b));
+   else
+      *this = fromMagnitude(other.negative(), subtractMagnitudes(b, a));
+   return *this;
+}
+
+inline BigInteger& BigInteger::operator-=(BigInteger const &other)
+{
+   int64_t s;
+   if (isSmall() && other.isSmall() && !__builtin_sub_overflow(m_small, other.m_small, &s))
+   {
+      m_small = s;
+      return *this;
+   }
+   return (*this) += -other;
+}
+
+inline BigInteger& BigInteger::operator*=(BigInteger const &other)
+{
+   int64_t s;
+   if (isSmall() && other.isSmall() && !__builtin_mul_overflow(m_small, other.m_small, &s))
+   {
+      m_small = s;
+      return *this;
+   }
+   *this = fromMagnitude(negative() != other.negative(), multiplyMagnitudes(magnitude(), other.magnitude()));
+   return *this;
+}
+
+inline void divideWithRemainder(BigInteger const &a, BigInteger const &b, BigInteger &quotient, BigInteger &remainder)
+{
+   assert(!b.isZero());
+   if (a.isSmall() && b.isSmall() && !((a.m_small == INT64_MIN) && (b.m_small == -1)))
+   {
+      int64_t q = a.m_small/b.m_small, r = a.m_small%b.m_small;
+      quotient = BigInteger(q);
+      remainder = BigInteger(r);
+      return;
+   }
+   BigInteger::Limbs q, r;
+   BigInteger::divideMagnitudes(a.magnitude(), b.magnitude(), q, r);
+   quotient = BigInteger::fromMagnitude(a.negative() != b.negative(), std::move(q));
+   remainder = BigInteger::fromMagnitude(a.negative(), std::move(r));
+}
+
+inline BigInteger& BigInteger::operator/=(BigInteger const &other)
+{
+   BigInteger remainder;
+   divideWithRemainder(*this, other, *this, remainder);
+   return *this;
+}
+
+inline BigInteger& BigInteger::operator%=(BigInteger const &other)
+{
+   BigInteger quotient;
+   divideWithRemainder(*this, other, quotient, *this);
+   return *this;
+}
+
+inline bool BigInteger::operator==(BigInteger const &other) const
+{
+   if (isSmall() != other.isSmall()) return false; // Both are canonical.
+   if (isSmall()) return m_small == other.m_small;
+   return (m_negative == other.m_negative) && (m_limbs == other.m_limbs);
+}
+
+inline bool BigInteger::operator!=(BigInteger const &other) const
+{
+   return !((*this) == other);
+}
+
+inline bool BigInteger::operator<(BigInteger const &other) const
+{
+   if (isSmall() && other.isSmall()) return m_small < other.m_small;
+   if (negative() != other.negative()) return negative();
+   int c = compareMagnitudes(magnitude(), other.magnitude());
+   return negative() ? (c > 0) : (c < 0);
+}
+
+inline BigInteger gcd(BigInteger a, BigInteger b)
+{
+   while (!b.isZero())
+   {
+      if (a.isSmall() && b.isSmall())
+      {
+         // Native Euclid on the magnitudes (which may be 2^63).
+         uint64_t x = (a.m_small < 0) ? uint64_t(0)-uint64_t(a.m_small) : uint64_t(a.m_small);
+         uint64_t y = (b.m_small < 0) ? uint64_t(0)-uint64_t(b.m_small) : uint64_t(b.m_small);
+         while (y != 0)
+         {
+            uint64_t r = x%y;
+            x = y;
+            y = r;
+         }
+         return BigInteger::fromMagnitude(false, BigInteger::Limbs {uint32_t(x), uint32_t(x >> 32)});
+      }
+      a %= b;
+      std::swap(a, b);
+   }
+   return (a.sign() < 0) ? -a : a;
+}
+
+inline BigInteger operator+(BigInteger a, BigInteger const &b) {return a += b;}
+inline BigInteger operator-(BigInteger a, BigInteger const &b) {return a -= b;}
+inline BigInteger operator*(BigInteger a, BigInteger const &b) {return a *= b;}
+inline BigInteger operator/(BigInteger a, BigInteger const &b) {return a /= b;}
+inline BigInteger operator%(BigInteger a, BigInteger const &b) {return a %= b;}
+inline std::ostream& operator<<(std::ostream &out, BigInteger const &a) {return out << a.toString();}
+
+
+// Rational - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+inline Rational::Rational(long long numerator)
+   : m_numerator(numerator), m_denominator(1)
+{
+}
+
+inline Rational::Rational(BigInteger numerator, BigInteger denominator)
+   : m_numerator(std::move(numerator)), m_denominator(std::move(denominator))
+{
+   assert(!m_denominator.isZero());
+   reduce();
+}
+
+inline void Rational::reduce()
+{
+   if (m_denominator.sign() < 0)
+   {
+      m_numerator = -m_numerator;
+      m_denominator = -m_denominator;
+   }
+   if (m_denominator == 1) return;
+   BigInteger g = ::gcd(m_numerator, m_denominator);
+   if (g != 1)
+   {
+      m_numerator /= g;
+      m_denominator /= g;
+   }
+}
+
+inline BigInteger const& Rational::numerator() const
+{
+   return m_numerator;
+}
+
+inline BigInteger const& Rational::denominator() const
+{
+   return m_denominator;
+}
+
+inline bool Rational::isZero() const
+{
+   return m_numerator.isZero();
+}
+
+inline bool Rational::isInteger() const
+{
+   return m_denominator == 1;
+}
+
+inline std::string Rational::toString() const
+{
+   return isInteger() ? m_numerator.toString() : m_numerator.toString()+"/"+m_denominator.toString();
+}
+
+inline Rational Rational::operator-() const
+{
+   Rational res(*this);
+   res.m_numerator = -res.m_numerator;
+   return res;
+}
+
+inline Rational& Rational::operator+=(Rational const &other)
+{
+   if (isInteger() && other.isInteger())
+   {
+      m_numerator += other.m_numerator;
+      return *this;
+   }
+   if (m_denominator == other.m_denominator)
+   {
+      m_numerator += other.m_numerator;
+      reduce();
+      return *this;
+   }
+   m_numerator = m_numerator*other.m_denominator+other.m_numerator*m_denominator;
+   m_denominator *= other.m_denominator;
+   reduce();
+   return *this;
+}
+
+inline Rational& Rational::operator-=(Rational const &other)
+{
+   return (*this) += -other;
+}
+
+inline Rational& Rational::operator*=(Rational const &other)
+{
+   if (isInteger() && other.isInteger())
+   {
+      m_numerator *= other.m_numerator;
+      return *this;
+   }
+   // Cross-cancellation keeps the intermediate products small.
+   BigInteger g1 = ::gcd(m_numerator, other.m_denominator), g2 = ::gcd(other.m_numerator, m_denominator);
+   m_numerator = (m_numerator/g1)*(other.m_numerator/g2);
+   m_denominator = (m_denominator/g2)*(other.m_denominator/g1);
+   if (m_numerator.isZero()) m_denominator = 1;
+   return *this;
+}
+
+inline Rational& Rational::operator/=(Rational const &other)
+{
+   assert(!other.isZero());
+   return (*this) *= Rational(other.m_denominator, other.m_numerator);
+}
+
+inline bool Rational::operator==(Rational const &other) const
+{
+   return (m_numerator == other.m_numerator) && (m_denominator == other.m_denominator);
+}
+
+inline bool Rational::operator!=(Rational const &other) const
+{
+   return !((*this) == other);
+}
+
+inline Rational Rational::gcd(Rational const &a, Rational const &b)
+{
+   BigInteger lcm = (a.m_denominator/::gcd(a.m_denominator, b.m_denominator))*b.m_denominator;
+   return Rational(::gcd(a.m_numerator, b.m_numerator), lcm);
+}
+
+inline Rational operator+(Rational a, Rational const &b) {return a += b;}
+inline Rational operator-(Rational a, Rational const &b) {return a -= b;}
+inline Rational operator*(Rational a, Rational const &b) {return a *= b;}
+inline Rational operator/(Rational a, Rational const &b) {return a /= b;}
+inline std::ostream& operator<<(std::ostream &out, Rational const &a) {return out << a.toString();}
+
+
+#endif
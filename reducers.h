@@ -0,0 +1,208 @@
+// reducers.h
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// ReducerIndex - finds, among a set of (leading) monomials, the ones that divide a given monomial.
+// (1) Every monomial has a 64-bit divisibility mask: a few bits per variable, where the k-th bit
+//     of a variable is set iff its power is greater than k. If a | b then mask(a) is a subset of
+//     mask(b), so most non-divisors are rejected by a single AND.
+// (2) The monomials are kept in a kd-tree over the exponents. An inner node splits its monomials
+//     by (power of a variable < value), and a lookup for the divisors of m never enters the upper
+//     side when the power of m is smaller than value. Leaves hold up to LEAF_SIZE monomials.
+// Every monomial is identified by an id (e.g. its index in the basis). Lookups return the smallest
+// matching id, so a linear scan for the first divisor can be replaced without changing results.
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef reducers_H__
+#define reducers_H__
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "monomials.h"
+
+
+// ** class ReducerIndex
+////////////////////////////////////////////////////////////////////////////
+template<typename PolyRing>
+class ReducerIndex
+{
+public:
+   static const size_t npos = size_t(-1);
+   static const size_t LEAF_SIZE = 8;
+
+   ReducerIndex();
+
+   void insert(Monomial<PolyRing> const &m, size_t id);
+   void clear();
+   size_t size() const;
+
+   // The smallest id whose monomial divides m (and for which accept(id) holds), or npos.
+   size_t find(Monomial<PolyRing> const &m) const;
+   template<typename Predicate>
+   size_t find(Monomial<PolyRing> const &m, Predicate&& accept) const;
+
+   static uint64_t divisibilityMask(Monomial<PolyRing> const &m);
+
+private:
+   struct Entry
+   {
+      uint64_t mask;
+      Monomial<PolyRing> monomial;
+      size_t id;
+   };
+
+   struct Node
+   {
+      bool leaf = true;
+      size_t variable = 0;  // Inner nodes: monomials with (m[variable] < value) are under lower, the rest under upper.
+      unsigned int value = 0;
+      size_t lower = 0, upper = 0;
+      size_t min_id = npos; // The smallest id in the subtree.
+      std::vector<Entry> entries; // Leaves only.
+   };
+
+   void split(size_t node);
+
+private:
+   std::vector<Node> m_nodes;
+   size_t m_size;
+};
+
+
+
+// ReducerIndex - Implementation
+////////////////////////////////////////////////////////////////////////////
+
+template<typename PolyRing>
+ReducerIndex<PolyRing>::ReducerIndex()
+{
+   clear();
+}
+
+template<typename PolyRing>
+void ReducerIndex<PolyRing>::clear()
+{
+   m_nodes.assign(1, Node());
+   m_size = 0;
+}
+
+template<typename PolyRing>
+size_t ReducerIndex<PolyRing>::size() const
+{
+   return m_size;
+}
+
+template<typename PolyRing>
+uint64_t ReducerIndex<PolyRing>::divisibilityMask(Monomial<PolyRing> const &m)
+{
+   const size_t n = variablesOf<PolyRing>();
+   const size_t bits = std::max<size_t>(64/n, 1);
+   uint64_t mask = 0;
+   for (size_t i = 0; i < n; ++i)
+   {
+      size_t set_bits = std::min<size_t>(m[i], bits);
+      if (set_bits != 0)
+         mask |= ((~uint64_t(0)) >> (64-set_bits)) << ((i*bits)%64);
+   }
+   return mask;
+}
+
+template<typename PolyRing>
+void ReducerIndex<PolyRing>::insert(Monomial<PolyRing> const &m, size_t id)
+{
+   size_t node = 0;
+   while (true)
+   {
+      m_nodes[node].min_id = std::min(m_nodes[node].min_id, id);
+      if (m_nodes[node].leaf) break;
+      node = (m[m_nodes[node].variable] < m_nodes[node].value) ? m_nodes[node].lower : m_nodes[node].upper;
+   }
+   m_nodes[node].entries.push_back(Entry {divisibilityMask(m), m, id});
+   ++m_size;
+   if (m_nodes[node].entries.size() > LEAF_SIZE)
+      split(node);
+}
+
+template<typename PolyRing>
+void ReducerIndex<PolyRing>::split(size_t node)
+{
+   // Splits by the variable with the largest spread, at its median power.
+   auto const &entries = m_nodes[node].entries;
+   size_t variable = 0;
+   unsigned int spread = 0;
+   for (size_t i = 0; i < variablesOf<PolyRing>(); ++i)
+   {
+      auto bounds = std::minmax_element(entries.begin(), entries.end(), [i](Entry const &a, Entry const &b) {return a.monomial[i] < b.monomial[i];});
+      unsigned int curr = bounds.second->monomial[i]-bounds.first->monomial[i];
+      if (curr > spread)
+      {
+         spread = curr;
+         variable = i;
+      }
+   }
+   if (spread == 0) return; // All the monomials are equal.
+
+   std::vector<unsigned int> powers;
+   for (auto const &entry: entries)
+      powers.push_back(entry.monomial[variable]);
+   std::nth_element(powers.begin(), powers.begin()+powers.size()/2, powers.end());
+   unsigned int value = std::max(powers[powers.size()/2], *std::min_element(powers.begin(), powers.end())+1);
+
+   Node lower, upper;
+   for (auto &entry: m_nodes[node].entries)
+   {
+      Node &side = (entry.monomial[variable] < value) ? lower : upper;
+      side.min_id = std::min(side.min_id, entry.id);
+      side.entries.push_back(std::move(entry));
+   }
+   m_nodes.push_back(std::move(lower));
+   m_nodes.push_back(std::move(upper));
+
+   Node &parent = m_nodes[node];
+   parent.entries.clear();
+   parent.entries.shrink_to_fit();
+   parent.leaf = false;
+   parent.variable = variable;
+   parent.value = value;
+   parent.lower = m_nodes.size()-2;
+   parent.upper = m_nodes.size()-1;
+}
+
+template<typename PolyRing>
+size_t ReducerIndex<PolyRing>::find(Monomial<PolyRing> const &m) const
+{
+   return find(m, [](size_t) {return true;});
+}
+
+template<typename PolyRing>
+template<typename Predicate>
+size_t ReducerIndex<PolyRing>::find(Monomial<PolyRing> const &m, Predicate&& accept) const
+{
+   const uint64_t mask = divisibilityMask(m);
+   size_t best = npos;
+   std::vector<size_t> stack {0};
+   while (!stack.empty())
+   {
+      Node const &node = m_nodes[stack.back()];
+      stack.pop_back();
+      if (node.min_id >= best) continue;
+      if (!node.leaf)
+      {
+         if (m[node.variable] >= node.value) stack.push_back(node.upper);
+         stack.push_back(node.lower);
+         continue;
+      }
+      for (auto const &entry: node.entries)
+      {
+         if ((entry.id < best) && ((entry.mask & ~mask) == 0) &&
+             entry.monomial.exponents().divides(m.exponents()) && accept(entry.id))
+            best = entry.id;
+      }
+   }
+   return best;
+}
+
+
+#endif
@@ -0,0 +1,211 @@
+// signatures.h
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// A signature-based algorithm for computing a Groebner Basis (the "RB" algorithm of Eder and
+// Roune, in the family of F5 and GVW).
+// Every basis element g carries a signature sig(g) = m*e_i - the leading term of a module
+// representation g = sum h_i*f_i over the generators. Signatures are ordered position over term
+// (by the index i first, then by m). Critical pairs are handled in an increasing signature order,
+// only by regular reductions (reductions that do not increase the signature), which lets two
+// criteria discard pairs before they are ever reduced:
+// (1) Syzygy criterion - the signature is divisible by the signature of a known syzygy (Koszul
+//     syzygies of the basis elements, and pairs that were reduced to zero).
+// (2) Rewrite criterion - the signature is divisible by the signature of a later basis element,
+//     which would produce the same polynomial (up to lower signatures).
+// Regular reductions leave the basis elements less reduced than Buchberger's, so rounding errors
+// accumulate faster with floating point coefficients (an exact field is preferable).
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef signatures_H__
+#define signatures_H__
+
+#include <deque>
+#include <queue>
+#include <vector>
+#include <type_traits>
+#include <initializer_list>
+
+#include "monomials.h"
+#include "polynomials.h"
+#include "division.h"
+#include "buchbergers.h"
+#include "geobuckets.h"
+
+
+// Declarations
+////////////////////////////////////////////////////////////////////////////
+
+// The signature m*e_index.
+template<typename PolyRing>
+struct Signature
+{
+   Monomial<PolyRing> monomial;
+   size_t index;
+
+   bool operator==(Signature<PolyRing> const &other) const {return (index == other.index) && (monomial == other.monomial);}
+};
+
+// Position over term: a*e_i < b*e_j iff i < j, or i == j and a < b.
+template<typename MonomialOrdering, typename PolyRing>
+bool signatureLess(Signature<PolyRing> const &s1, Signature<PolyRing> const &s2);
+
+// Relation: signature | signature
+template<typename PolyRing>
+bool divides(Signature<PolyRing> const &divisor, Signature<PolyRing> const &dividend);
+
+// Produces a Groebner Basis for a given set of generators, by a signature-based algorithm. Unlike
+// runBuchbergers, the result does not hold the generators themselves, but elements that generate the
+// same ideal (so it can be passed to makeMinimalGroebner as well).
+// In the statistics, reductions are the critical pairs that were reduced, and the discarded pairs are
+// the ones rejected by the signature criteria (or singular, i.e. both halves had the same signature).
+template<typename GeneratorsContainer>
+std::decay_t<GeneratorsContainer> runSignatureBuchbergers(GeneratorsContainer&& ideal_generators, BuchbergerStatistics *statistics=nullptr);
+
+// Utility wrapper for initializer-lists.
+template<typename PolyRing, typename MonomialOrdering>
+std::deque<Polynomial<PolyRing, MonomialOrdering>> runSignatureBuchbergers(std::initializer_list<Polynomial<PolyRing, MonomialOrdering>> ideal_generators,
+                                                                           BuchbergerStatistics *statistics=nullptr);
+
+
+
+// Definitions
+////////////////////////////////////////////////////////////////////////////
+
+template<typename MonomialOrdering, typename PolyRing>
+bool signatureLess(Signature<PolyRing> const &s1, Signature<PolyRing> const &s2)
+{
+   if (s1.index != s2.index) return s1.index < s2.index;
+   return MonomialOrdering::lessThen(s1.monomial, s2.monomial);
+}
+
+template<typename PolyRing>
+bool divides(Signature<PolyRing> const &divisor, Signature<PolyRing> const &dividend)
+{
+   return (divisor.index == dividend.index) && divides(divisor.monomial, dividend.monomial);
+}
+
+template<typename GeneratorsContainer>
+std::decay_t<GeneratorsContainer> runSignatureBuchbergers(GeneratorsContainer&& ideal_generators, BuchbergerStatistics *statistics)
+{
+   using PolynomialType = typename std::decay_t<GeneratorsContainer>::value_type;
+   using PolyRing = typename PolynomialType::Ring;
+   using MonomialOrdering = typename PolynomialType::Ordering;
+   using TermType = typename PolynomialType::TermType;
+   using SignatureType = Signature<PolyRing>;
+
+   auto multiplied = [](Monomial<PolyRing> const &m, SignatureType s) {s.monomial *= m; return s;};
+
+   std::decay_t<GeneratorsContainer> groebner_basis;
+   std::vector<SignatureType> signatures; // Of the basis elements.
+   std::vector<SignatureType> syzygies;
+   ReducerIndex<PolyRing> leading_index;
+   BuchbergerStatistics counters;
+
+   // Fully reduces p (whose signature is s) by regular reductions only: g may reduce a term t*LM(g) iff t*sig(g) < s.
+   auto regularReduce = [&](PolynomialType p, SignatureType const &s) {
+      PolynomialType reduced(p.terms());
+      Geobucket<PolynomialType> remaining(p);
+      TermType leading;
+      while (remaining.popLeadingTerm(leading))
+      {
+         size_t k = leading_index.find(leading.getMonomial(), [&](size_t j) {
+            Monomial<PolyRing> t(leading.getMonomial());
+            t /= LM(groebner_basis[j]);
+            return signatureLess<MonomialOrdering>(multiplied(t, signatures[j]), s);
+         });
+         if (k != leading_index.npos)
+         {
+            // The leading term cancels exactly, so only the tail of g is subtracted (no rounding errors).
+            auto const &g = groebner_basis[k];
+            remaining.add(-1*safelyDivide(LT(g), leading), g, 1);
+         }
+         else
+            reduced.appendTerm(std::move(leading));
+      }
+      return reduced;
+   };
+
+   // A J-pair is the larger half t*g_k of an S-Polynomial (its regular reduction subtracts the other half).
+   struct JPair
+   {
+      SignatureType signature;
+      Monomial<PolyRing> multiplier;
+      size_t k;
+   };
+   auto greater = [](JPair const &a, JPair const &b) {return signatureLess<MonomialOrdering>(b.signature, a.signature);};
+   std::priority_queue<JPair, std::vector<JPair>, decltype(greater)> pairs(greater);
+
+   // Elements are kept monic (the coefficient of a signature is immaterial).
+   auto insert = [&](PolynomialType g, SignatureType s) {
+      g.normalize();
+      size_t k = groebner_basis.size();
+      for (size_t j = 0; j < k; ++j)
+      {
+         auto const &h = groebner_basis[j];
+         auto lcm = LCM(LM(g), LM(h));
+         Monomial<PolyRing> u_k(lcm), u_j(lcm);
+         u_k /= LM(g);
+         u_j /= LM(h);
+         SignatureType s_k = multiplied(u_k, s), s_j = multiplied(u_j, signatures[j]);
+
+         // The Koszul syzygy h*g - g*h.
+         SignatureType koszul_k = multiplied(LM(h), s), koszul_j = multiplied(LM(g), signatures[j]);
+         if (!(koszul_k == koszul_j))
+            syzygies.push_back(signatureLess<MonomialOrdering>(koszul_k, koszul_j) ? koszul_j : koszul_k);
+
+         if (s_k == s_j) ++counters.pairs_discarded;
+         else if (signatureLess<MonomialOrdering>(s_j, s_k)) pairs.push(JPair {s_k, u_k, k});
+         else pairs.push(JPair {s_j, u_j, j});
+      }
+      leading_index.insert(LM(g), k);
+      groebner_basis.push_back(std::move(g));
+      signatures.push_back(std::move(s));
+   };
+
+   size_t index = 0;
+   for (auto const &generator: ideal_generators)
+   {
+      // Every signature of the previous generators is smaller than e_index.
+      SignatureType e {Monomial<PolyRing>(), index++};
+      auto g = regularReduce(generator, e);
+      if (g.terms() == 0) continue;
+      insert(std::move(g), e);
+
+      while (!pairs.empty())
+      {
+         JPair pair = pairs.top();
+         pairs.pop();
+         bool rejected = std::any_of(syzygies.begin(), syzygies.end(), [&pair](SignatureType const &z) {return divides(z, pair.signature);});
+         for (size_t m = pair.k+1; (m < signatures.size()) && (!rejected); ++m)
+            rejected = divides(signatures[m], pair.signature);
+         if (rejected)
+         {
+            ++counters.pairs_discarded;
+            continue;
+         }
+
+         ++counters.reductions;
+         auto reduced = regularReduce(TermType(1, pair.multiplier)*groebner_basis[pair.k], pair.signature);
+         if (reduced.terms() == 0)
+         {
+            ++counters.zero_reductions;
+            syzygies.push_back(pair.signature);
+         }
+         else insert(std::move(reduced), pair.signature);
+      }
+   }
+
+   if (statistics) *statistics = counters;
+   return groebner_basis;
+}
+
+template<typename PolyRing, typename MonomialOrdering>
+std::deque<Polynomial<PolyRing, MonomialOrdering>> runSignatureBuchbergers(std::initializer_list<Polynomial<PolyRing, MonomialOrdering>> ideal_generators,
+                                                                           BuchbergerStatistics *statistics)
+{
+   return runSignatureBuchbergers(std::deque<Polynomial<PolyRing, MonomialOrdering>>(ideal_generators), statistics);
+}
+
+
+#endif
@@ -0,0 +1,246 @@
+#include <chrono>
+#include <random>
+#include <iostream>
+
+#include "monomials.h"
+#include "polynomials.h"
+#include "primefield.h"
+#include "buchbergers.h"
+#include "parallel.h"
+#include "geobuckets.h"
+
+
+// Sorting
+////////////////////////////////////////////////////////////////////////////
+
+template<typename PolyRing>
+std::vector<Term<PolyRing>> randomTerms(size_t count, unsigned int max_power)
+{
+   std::mt19937 gen(7);
+   std::uniform_int_distribution<unsigned int> power(0, max_power);
+   std::vector<Term<PolyRing>> terms;
+   terms.reserve(count);
+   for (size_t i = 0; i < count; ++i)
+   {
+      Monomial<PolyRing> m;
+      for (size_t j = 0; j < PolyRing::VARIABLES; ++j)
+         m.set(j, power(gen));
+      terms.emplace_back(1.0, m);
+   }
+   return terms;
+}
+
+template<typename Func>
+double measure(Func&& func, size_t repetitions)
+{
+   auto start = std::chrono::steady_clock::now();
+   for (size_t i = 0; i < repetitions; ++i)
+      func();
+   std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now()-start;
+   return elapsed.count()/repetitions;
+}
+
+template<typename MonomialOrdering, typename PolyRing>
+void benchmarkSort(std::string const &name, size_t count)
+{
+   auto const terms = randomTerms<PolyRing>(count, 12);
+   const size_t repetitions = 20;
+
+   double with_comparator = measure([&terms]() {
+      auto copy = terms;
+      std::sort(copy.rbegin(), copy.rend(),
+                [](Term<PolyRing> const &m1, Term<PolyRing> const &m2) {return MonomialOrdering::lessThen(m1.getMonomial(), m2.getMonomial());});
+   }, repetitions);
+
+   double with_keys = measure([&terms]() {
+      auto copy = terms;
+      sortTerms<MonomialOrdering>(copy);
+   }, repetitions);
+
+   std::cout << name << " (" << count << " terms): lessThen " << with_comparator << "ms, "
+             << "sortKey " << with_keys << "ms, speedup x" << with_comparator/with_keys << std::endl;
+}
+
+
+// Multiplication
+////////////////////////////////////////////////////////////////////////////
+
+template<typename PolynomialType>
+PolynomialType randomPolynomial(size_t terms, unsigned int max_power)
+{
+   PolynomialType p;
+   for (auto const &t: randomTerms<typename PolynomialType::Ring>(terms, max_power))
+      p += t;
+   return p;
+}
+
+template<typename MonomialOrdering, typename PolyRing>
+void benchmarkMultiplication(std::string const &name, size_t terms1, size_t terms2)
+{
+   using PolynomialType = Polynomial<PolyRing, MonomialOrdering>;
+   auto const p1 = randomPolynomial<PolynomialType>(terms1, 20);
+   auto const p2 = randomPolynomial<PolynomialType>(terms2, 20);
+
+   double termwise = measure([&p1, &p2]() {
+      PolynomialType product;
+      for (size_t i = 0; i < p1.terms(); ++i)
+         product += p2*p1[i];
+   }, 1);
+   double heap = measure([&p1, &p2]() {p1*p2;}, 1);
+
+   std::cout << name << " (" << p1.terms() << "x" << p2.terms() << " terms): termwise " << termwise << "ms, "
+             << "heap " << heap << "ms, speedup x" << termwise/heap << std::endl;
+}
+
+template<typename MonomialOrdering, typename PolyRing>
+void benchmarkParallelMultiplication(std::string const &name, size_t terms1, size_t terms2)
+{
+   using PolynomialType = Polynomial<PolyRing, MonomialOrdering>;
+   auto const p1 = randomPolynomial<PolynomialType>(terms1, 20);
+   auto const p2 = randomPolynomial<PolynomialType>(terms2, 20);
+
+   double serial = measure([&p1, &p2]() {p1*p2;}, 3);
+   std::cout << name << " (" << p1.terms() << "x" << p2.terms() << " terms): serial " << serial << "ms";
+   for (size_t threads = 2; threads <= std::max(2u, std::thread::hardware_concurrency()); threads *= 2)
+   {
+      ThreadPool pool(threads);
+      double parallel = measure([&p1, &p2, &pool]() {multiplyParallel(p1, p2, pool);}, 3);
+      std::cout << ", " << threads << " threads " << parallel << "ms";
+   }
+   std::cout << std::endl;
+}
+
+template<typename MonomialOrdering, typename PolyRing>
+void benchmarkSummation(std::string const &name, size_t summands, size_t terms)
+{
+   using PolynomialType = Polynomial<PolyRing, MonomialOrdering>;
+   // Shifted copies of a random polynomial, which overlap partially.
+   auto const p = randomPolynomial<PolynomialType>(terms, 30);
+   std::vector<PolynomialType> polynomials;
+   for (size_t i = 0; i < summands; ++i)
+   {
+      Monomial<PolyRing> shift;
+      shift.set(0, i%40);
+      shift.set(1, (i/40)%40);
+      polynomials.push_back(Term<PolyRing>(1.0, shift)*p);
+   }
+
+   double chained = measure([&polynomials]() {
+      PolynomialType sum;
+      for (auto const &p: polynomials) sum += p;
+   }, 3);
+   double geobucket = measure([&polynomials]() {
+      Geobucket<PolynomialType> sum;
+      for (auto const &p: polynomials) sum += p;
+      sum.sum();
+   }, 3);
+   std::cout << name << " (" << summands << " summands of " << terms << " terms): += " << chained << "ms, "
+             << "geobucket " << geobucket << "ms, speedup x" << chained/geobucket << std::endl;
+}
+
+
+// Coefficients
+////////////////////////////////////////////////////////////////////////////
+
+template<typename MonomialOrdering, typename PolyRing>
+double measureMultiplication(size_t terms1, size_t terms2)
+{
+   using PolynomialType = Polynomial<PolyRing, MonomialOrdering>;
+   auto const p1 = randomPolynomial<PolynomialType>(terms1, 20);
+   auto const p2 = randomPolynomial<PolynomialType>(terms2, 20);
+   return measure([&p1, &p2]() {p1*p2;}, 3);
+}
+
+template<typename MonomialOrdering, size_t N>
+void benchmarkCoefficients(std::string const &name, size_t terms1, size_t terms2)
+{
+   double native = measureMultiplication<MonomialOrdering, PolynomialRing<double, N>>(terms1, terms2);
+   double barrett = measureMultiplication<MonomialOrdering, PrimeFieldRing<2147483647, N>>(terms1, terms2);
+   double montgomery = measureMultiplication<MonomialOrdering, PrimeFieldRing<9223372036854775783ull, N>>(terms1, terms2);
+   std::cout << name << " (" << terms1 << "x" << terms2 << " terms): double " << native << "ms, "
+             << "Z_p (31 bits) " << barrett << "ms, Z_p (63 bits) " << montgomery << "ms" << std::endl;
+}
+
+
+// Groebner Bases
+////////////////////////////////////////////////////////////////////////////
+
+// The cyclic-n system (n = VARIABLES), with random coefficients.
+template<typename PolynomialType>
+std::deque<PolynomialType> randomCyclic()
+{
+   using PolyRing = typename PolynomialType::Ring;
+   const size_t n = variablesOf<PolyRing>();
+   std::mt19937 gen(7);
+   std::uniform_int_distribution<int> coefficient(1, 1000);
+   std::deque<PolynomialType> generators;
+   for (size_t k = 1; k <= n; ++k)
+   {
+      PolynomialType p;
+      for (size_t i = 0; i < ((k < n) ? n : 1); ++i)
+      {
+         Monomial<PolyRing> m;
+         for (size_t j = 0; j < k; ++j)
+            m.set((i+j)%n, 1);
+         p += Term<PolyRing>(coefficient(gen), m);
+      }
+      if (k == n) p += Term<PolyRing>(coefficient(gen), Monomial<PolyRing>());
+      generators.push_back(p);
+   }
+   return generators;
+}
+
+template<typename PolynomialType>
+void benchmarkParallelBuchbergers(std::string const &name)
+{
+   auto const generators = randomCyclic<PolynomialType>();
+   double serial = measure([&generators]() {runBuchbergers(generators);}, 3);
+   std::cout << name << ": runBuchbergers " << serial << "ms";
+   for (size_t threads = 1; threads <= std::thread::hardware_concurrency(); threads *= 2)
+   {
+      ThreadPool pool(threads);
+      double parallel = measure([&generators, &pool]() {runParallelBuchbergers(generators, pool);}, 3);
+      std::cout << ", " << threads << " threads " << parallel << "ms";
+   }
+   std::cout << std::endl;
+}
+
+// Runtime-sized rings
+////////////////////////////////////////////////////////////////////////////
+
+template<size_t N>
+void benchmarkRuntimeRing(std::string const &name)
+{
+   const uint64_t P = 2147483647;
+   using Fixed = Polynomial<PrimeFieldRing<P, N>, GrevlexOrder>;
+   using InlineExponents = RuntimeExponents<8>;
+   using PooledExponents = RuntimeExponents<2>;
+   InlineExponents::load(N, OrderingId::Grevlex);
+   PooledExponents::load(N, OrderingId::Grevlex);
+   using Inline = Polynomial<PrimeFieldRing<P, InlineExponents::VARIABLES, InlineExponents>, RuntimeOrder>;
+   using Pooled = Polynomial<PrimeFieldRing<P, PooledExponents::VARIABLES, PooledExponents>, RuntimeOrder>;
+
+   double fixed = measure([]() {runBuchbergers(randomCyclic<Fixed>());}, 3);
+   double inline_powers = measure([]() {runBuchbergers(randomCyclic<Inline>());}, 3);
+   double pooled_powers = measure([]() {runBuchbergers(randomCyclic<Pooled>());}, 3);
+   std::cout << name << ": compile-time " << fixed << "ms, runtime (inline) " << inline_powers << "ms (x" << inline_powers/fixed
+             << "), runtime (pooled) " << pooled_powers << "ms (x" << pooled_powers/fixed << ")" << std::endl;
+}
+
+
+int main()
+{
+   benchmarkSort<LexOrder, PolynomialRing<double, 3>>("lex, 3 variables", 20000);
+   benchmarkSort<GrlexOrder, PolynomialRing<double, 3>>("grlex, 3 variables", 20000);
+   benchmarkSort<GrevlexOrder, PolynomialRing<double, 3>>("grevlex, 3 variables", 20000);
+   benchmarkSort<GrevlexOrder, PolynomialRing<double, 6>>("grevlex, 6 variables", 20000);
+   benchmarkSort<GrevlexOrder, PackedPolynomialRing<double, 6>>("grevlex, 6 packed variables", 20000);
+   benchmarkMultiplication<GrevlexOrder, PolynomialRing<double, 3>>("grevlex, 3 variables", 500, 500);
+   benchmarkMultiplication<GrevlexOrder, PolynomialRing<double, 3>>("grevlex, 3 variables", 20, 5000);
+   benchmarkParallelMultiplication<GrevlexOrder, PolynomialRing<double, 3>>("grevlex, 3 variables", 1000, 1000);
+   benchmarkSummation<GrevlexOrder, PolynomialRing<double, 3>>("grevlex, 3 variables", 5000, 20);
+   benchmarkCoefficients<GrevlexOrder, 3>("grevlex, 3 variables", 500, 500);
+   benchmarkParallelBuchbergers<Polynomial<PrimeFieldRing<2147483647, 6>, GrevlexOrder>>("cyclic-6 over Z_p");
+   benchmarkRuntimeRing<6>("cyclic-6 over Z_p");
+   return 0;
+}
@@ -9,13 +9,40 @@ int main()
    testMonomial();
    testLex();
    testGrlex();
+   testPackedMonomial();
+   testOrderingKeys();
    testPolynomial();
+   testPolynomialAddition();
+   testSortedTerms();
+   testPolynomialMultiplication();
    testDivides();
    testDivision();
+   testDivisionIdentity();
    testSPoly();
    testBuchbergers1();
    testBuchbergers2();
    testBuchbergers3();
+   testCriticalPairs();
+   testStrategies();
+   testPackedBuchbergers();
+   testF4();
+   testSignatureBuchbergers();
+   testReducerIndex();
+   testReducedGroebner();
+   testPrimeFields();
+   testBigInteger();
+   testRational();
+   testRationalGroebner();
+   testRationalReconstruction();
+   testModularGroebner();
+   testBuchbergerTrace();
+   testThreadPool();
+   testParallelBuchbergers();
+   testParallelMultiplication();
+   testGeobucket();
+   testPolynomialArena();
+   testBuchbergerMonitor();
+   testRuntimeRings();
    return 0;
 }
 
@@ -4,18 +4,32 @@
 #ifndef tests_H__
 #define tests_H__
 
+#include <deque>
+#include <random>
+#include <thread>
 #include <cassert>
 
 #include "monomials.h"
 #include "polynomials.h"
 #include "division.h"
 #include "buchbergers.h"
+#include "f4.h"
+#include "signatures.h"
+#include "primefield.h"
+#include "rationals.h"
+#include "modular.h"
+#include "parallel.h"
+#include "geobuckets.h"
+#include "arena.h"
 
 namespace Tests
 {
    using PolyRing2 = PolynomialRing<double, 2>;
    using PolyRing3 = PolynomialRing<double, 3>;
    using PolyRing4 = PolynomialRing<double, 4>;
+   using PackedRing2 = PackedPolynomialRing<double, 2, 8>;
+   using PackedRing5 = PackedPolynomialRing<double, 5, 16>;
+   using DenseRing5 = PolynomialRing<double, 5>;
 
    template<class PolyRing>
    Monomial<PolyRing> X(size_t i) {Monomial<PolyRing> x; x.set(i, 1); return x;}
@@ -83,6 +97,91 @@ namespace Tests
       assert(!GrlexOrder::lessThen(m3, m4));
    }
 
+   void testPackedMonomial()
+   {
+      std::mt19937 gen(17);
+      std::uniform_int_distribution<unsigned int> power(0, 6);
+      for (size_t iteration = 0; iteration < 1000; ++iteration)
+      {
+         Monomial<DenseRing5> d1, d2;
+         Monomial<PackedRing5> p1, p2;
+         for (size_t i = 0; i < 5; ++i)
+         {
+            unsigned int a = power(gen), b = power(gen);
+            d1.set(i, a); p1.set(i, a);
+            d2.set(i, b); p2.set(i, b);
+         }
+         assert(p1.powersSum() == d1.powersSum());
+         assert((p1 == p2) == (d1 == d2));
+         assert(LexOrder::lessThen(p1, p2) == LexOrder::lessThen(d1, d2));
+         assert(GrlexOrder::lessThen(p1, p2) == GrlexOrder::lessThen(d1, d2));
+         assert(GrevlexOrder::lessThen(p1, p2) == GrevlexOrder::lessThen(d1, d2));
+         assert(divides(p1, p2) == divides(d1, d2));
+
+         auto d_lcm = LCM(d1, d2);
+         auto p_lcm = LCM(p1, p2);
+         auto p_product = p1;
+         p_product *= p2;
+         auto d_product = d1;
+         d_product *= d2;
+         for (size_t i = 0; i < 5; ++i)
+         {
+            assert(p_lcm[i] == d_lcm[i]);
+            assert(p_product[i] == d_product[i]);
+         }
+         assert(p_lcm.powersSum() == d_lcm.powersSum());
+         assert(p_product.powersSum() == d_product.powersSum());
+         assert(divides(p1, p_product) && divides(p2, p_lcm));
+         p_product /= p2;
+         assert(p_product == p1);
+      }
+   }
+
+   template<typename MonomialOrdering, typename PolyRing>
+   void testOrderingKey(unsigned int max_power)
+   {
+      std::mt19937 gen(29);
+      std::uniform_int_distribution<unsigned int> power(0, max_power);
+      for (size_t iteration = 0; iteration < 1000; ++iteration)
+      {
+         Monomial<PolyRing> m1, m2;
+         for (size_t i = 0; i < PolyRing::VARIABLES; ++i)
+         {
+            m1.set(i, power(gen));
+            m2.set(i, power(gen));
+         }
+         auto k1 = MonomialOrdering::sortKey(m1);
+         auto k2 = MonomialOrdering::sortKey(m2);
+         assert((k1 < k2) == MonomialOrdering::lessThen(m1, m2));
+         assert((k1 == k2) == (m1 == m2));
+      }
+
+      std::vector<Term<PolyRing>> terms;
+      for (size_t i = 0; i < 200; ++i)
+      {
+         Monomial<PolyRing> m;
+         for (size_t j = 0; j < PolyRing::VARIABLES; ++j)
+            m.set(j, power(gen));
+         terms.emplace_back(1, m);
+      }
+      sortTerms<MonomialOrdering>(terms);
+      for (size_t i = 1; i < terms.size(); ++i)
+         assert(!MonomialOrdering::lessThen(terms[i-1].getMonomial(), terms[i].getMonomial()));
+   }
+
+   void testOrderingKeys()
+   {
+      testOrderingKey<LexOrder, PolyRing3>(4);
+      testOrderingKey<GrlexOrder, PolyRing3>(4);
+      testOrderingKey<GrevlexOrder, PolyRing3>(4);
+      testOrderingKey<LexOrder, PackedRing5>(4);
+      testOrderingKey<GrlexOrder, PackedRing5>(4);
+      testOrderingKey<GrevlexOrder, PackedRing5>(4);
+      // Keys which cannot be compressed into a single word.
+      testOrderingKey<GrlexOrder, PolyRing3>(1 << 28);
+      testOrderingKey<GrevlexOrder, PolyRing3>(1 << 28);
+   }
+
    void testPolynomial()
    {
       Polynomial<PolyRing3, LexOrder> p1;
@@ -98,6 +197,12 @@ namespace Tests
       assert(LC(p1) == 1);
       assert(LM(p1)[0] == 1);
       assert(LT(p1).getCoeff() == LC(p1));
+      for (size_t i = 0; i < p1.terms(); ++i)
+      {
+         assert(p1.coefficients()[i] == p1.getCoeff(i));
+         assert(p1.monomials()[i] == p1.getMonomial(i));
+         assert(p1[i] == Term<PolyRing3>(p1.getCoeff(i), p1.getMonomial(i)));
+      }
 
       Polynomial<PolyRing3, LexOrder> p2;
       p2 += p1;
@@ -111,6 +216,135 @@ namespace Tests
       assert(p2.terms() == 0);
    }
 
+   template<typename PolynomialType>
+   PolynomialType randomPolynomial(std::mt19937 &gen, size_t terms, unsigned int max_power, int max_coeff=5)
+   {
+      using PolyRing = typename PolynomialType::Ring;
+      std::uniform_int_distribution<unsigned int> power(0, max_power);
+      std::uniform_int_distribution<int> coeff(-max_coeff, max_coeff);
+      PolynomialType p;
+      for (size_t i = 0; i < terms; ++i)
+      {
+         Monomial<PolyRing> m;
+         for (size_t j = 0; j < PolyRing::VARIABLES; ++j)
+            m.set(j, power(gen));
+         p += Term<PolyRing>(coeff(gen), m);
+      }
+      return p;
+   }
+
+   template<typename PolynomialType>
+   bool identical(PolynomialType const &p1, PolynomialType const &p2)
+   {
+      PolynomialType difference(p1);
+      difference -= p2;
+      for (size_t i = 0; i < difference.terms(); ++i)
+         if (std::fabs(difference.getCoeff(i)) > 1e-9) return false;
+      return true;
+   }
+
+   void testPolynomialAddition()
+   {
+      using PolynomialType = Polynomial<PolyRing3, GrevlexOrder>;
+      std::mt19937 gen(3);
+      for (size_t iteration = 0; iteration < 50; ++iteration)
+      {
+         auto p1 = randomPolynomial<PolynomialType>(gen, 40, 3);
+         auto p2 = randomPolynomial<PolynomialType>(gen, 40, 3);
+
+         PolynomialType sum(p1), termwise_sum(p1);
+         sum += p2;
+         for (size_t i = 0; i < p2.terms(); ++i)
+            termwise_sum += p2[i];
+         assert(identical(sum, termwise_sum));
+         for (size_t i = 1; i < sum.terms(); ++i)
+            assert(GrevlexOrder::lessThen(sum.getMonomial(i), sum.getMonomial(i-1)));
+
+         sum -= p2;
+         assert(identical(sum, p1));
+         sum -= sum;
+         assert(sum.terms() == 0);
+      }
+   }
+
+   void testSortedTerms()
+   {
+      using PolynomialType = Polynomial<PrimeFieldRing<2147483647, 3>, GrevlexOrder>;
+      using TermType = PolynomialType::TermType;
+      std::mt19937 gen(13);
+      for (size_t iteration = 0; iteration < 20; ++iteration)
+      {
+         auto p = randomPolynomial<PolynomialType>(gen, 50, 4);
+         std::vector<TermType> terms;
+         for (size_t i = 0; i < p.terms(); ++i)
+            terms.push_back(p[i]);
+         assert(PolynomialType::fromSortedTerms(terms) == p);
+
+         // Out of order, repeated and zero terms are still accepted.
+         std::shuffle(terms.begin(), terms.end(), gen);
+         terms.push_back(terms[0]);
+         terms.push_back(TermType(0, Monomial<PolynomialType::Ring>({9,9,9})));
+         PolynomialType expected(p);
+         expected += terms[0];
+         auto q = PolynomialType::fromSortedTerms(terms);
+         assert(q == expected);
+         for (size_t i = 0; i < q.terms(); ++i)
+            assert(q.getCoeff(i) == expected.getCoeff(i));
+
+         // The same terms, read from a row-major array of powers (as passed in bulk by the Python binding).
+         std::vector<unsigned int> rows;
+         for (auto const &t: terms)
+            rows.insert(rows.end(), t.getMonomial().exponents().powers(), t.getMonomial().exponents().powers()+3);
+         auto r = PolynomialType::fromTerms(terms.size(),
+                                            [&terms](size_t i) {return terms[i].getCoeff();},
+                                            [&rows](size_t i) {return Monomial<PolynomialType::Ring>({rows[3*i], rows[3*i+1], rows[3*i+2]});});
+         assert(r == expected);
+
+         // Multiplying by a term or a coefficient keeps the order.
+         TermType m(3, Monomial<PolynomialType::Ring>({1,0,2}));
+         PolynomialType shifted(p), termwise;
+         shifted *= m;
+         for (size_t i = 0; i < p.terms(); ++i)
+         {
+            TermType t(p[i]);
+            t *= m;
+            termwise += t;
+         }
+         assert(shifted == termwise);
+         for (size_t i = 0; i < shifted.terms(); ++i)
+            assert(shifted.getCoeff(i) == termwise.getCoeff(i));
+         shifted *= PolynomialType::Ring::Coefficient(0);
+         assert(shifted.terms() == 0);
+      }
+   }
+
+   void testPolynomialMultiplication()
+   {
+      using PolynomialType = Polynomial<PolyRing3, GrlexOrder>;
+      std::mt19937 gen(5);
+      for (size_t iteration = 0; iteration < 20; ++iteration)
+      {
+         auto p1 = randomPolynomial<PolynomialType>(gen, 30, 4);
+         auto p2 = randomPolynomial<PolynomialType>(gen, 10+iteration, 4);
+
+         PolynomialType termwise_product;
+         for (size_t i = 0; i < p1.terms(); ++i)
+            termwise_product += p2*p1[i];
+
+         assert(identical(p1*p2, termwise_product));
+         assert(identical(p2*p1, termwise_product));
+         assert(identical(multiplyChunked(p1, p2, 3), termwise_product));
+         assert(identical(multiplyChunked(p1, p2, 1), termwise_product));
+      }
+
+      // (x-y)*(x+y) = x^2-y^2
+      PolynomialType f {{1, {{1,0,0}}}, {-1, {{0,1,0}}}};
+      PolynomialType g {{1, {{1,0,0}}}, {1, {{0,1,0}}}};
+      PolynomialType h {{1, {{2,0,0}}}, {-1, {{0,2,0}}}};
+      assert(identical(f*g, h));
+      assert((f*PolynomialType()).terms() == 0);
+   }
+
    void testDivides()
    { 
       Monomial<PolyRing3> x1({1,0,0});
@@ -200,6 +434,37 @@ namespace Tests
      }
    }
 
+   void testDivisionIdentity()
+   {
+      using PolynomialType = Polynomial<PolyRing3, GrevlexOrder>;
+      std::mt19937 gen(11);
+      for (size_t iteration = 0; iteration < 30; ++iteration)
+      {
+         // Monic divisors with small coefficients, so the (double) arithmetic is exact.
+         auto f = randomPolynomial<PolynomialType>(gen, 20, 4);
+         std::vector<PolynomialType> divisors;
+         for (size_t i = 0; i < 3; ++i)
+         {
+            divisors.push_back(randomPolynomial<PolynomialType>(gen, 4, 2, 1));
+            if (divisors.back().terms() == 0) divisors.back() += Term<PolyRing3>(1, {{1,1,1}});
+            divisors.back().normalize();
+         }
+
+         PolynomialType r;
+         std::vector<PolynomialType> quotients;
+         std::tie(r, quotients) = divide(f, divisors);
+
+         // f = sum(q_i*g_i) + r, and no term of r is divisible by any LT(g_i).
+         PolynomialType sum(r);
+         for (size_t i = 0; i < divisors.size(); ++i)
+            sum += quotients[i]*divisors[i];
+         assert(identical(sum, f));
+         for (size_t t = 0; t < r.terms(); ++t)
+            for (auto const &g: divisors)
+               assert(!divides(LT(g), r[t]));
+      }
+   }
+
    void testSPoly()
    {
       // f = x^3*y^2 - x^2*y^3 + x
@@ -343,6 +608,826 @@ namespace Tests
       assert(groebner[1] == f2_reduced);
    }
 
+   // Checks that every S-Polynomial of the basis (and every generator) reduces to zero.
+   template<typename BasisContainer, typename GeneratorsContainer>
+   bool isGroebnerBasis(BasisContainer const &basis, GeneratorsContainer const &generators)
+   {
+      for (auto const &g: generators)
+         if (std::get<0>(divide(g, basis)).terms() != 0) return false;
+      for (size_t i = 0; i < basis.size(); ++i)
+         for (size_t j = i+1; j < basis.size(); ++j)
+            if (std::get<0>(divide(makeSPolynomial(basis[i], basis[j]), basis)).terms() != 0) return false;
+      return true;
+   }
+
+   // The cyclic-n system: sum_i prod_{j<k} x_{i+j} (for k=1..n-1), and x_1*x_2*...*x_n - 1.
+   template<typename PolynomialType>
+   std::deque<PolynomialType> cyclic()
+   {
+      using PolyRing = typename PolynomialType::Ring;
+      const size_t n = variablesOf<PolyRing>();
+      std::deque<PolynomialType> generators;
+      for (size_t k = 1; k < n; ++k)
+      {
+         PolynomialType p;
+         for (size_t i = 0; i < n; ++i)
+         {
+            Monomial<PolyRing> m;
+            for (size_t j = 0; j < k; ++j)
+               m.set((i+j)%n, 1);
+            p += Term<PolyRing>(1, m);
+         }
+         generators.push_back(p);
+      }
+      Monomial<PolyRing> all;
+      for (size_t i = 0; i < n; ++i)
+         all.set(i, 1);
+      generators.push_back(PolynomialType {{1, all}, {-1, Monomial<PolyRing>()}});
+      return generators;
+   }
+
+   void testCriticalPairs()
+   {
+      using PolynomialType = Polynomial<PolyRing4, GrevlexOrder>;
+      auto generators = cyclic<PolynomialType>();
+      auto groebner = runBuchbergers(generators);
+      assert(generators.size() == 4);
+      assert(isGroebnerBasis(groebner, generators));
+
+      // x^2*y and z^3*w are coprime leading monomials (grevlex), so the pair (f, g) is never reduced.
+      PolynomialType f {{1, {{2,1,0,0}}}, {1, {{0,0,0,1}}}};
+      PolynomialType g {{1, {{0,0,3,1}}}, {1, {{0,0,0,2}}}};
+      CriticalPairs<PolynomialType> pairs;
+      std::deque<PolynomialType> basis {f*g, f, g};
+      for (size_t k = 0; k < basis.size(); ++k)
+         pairs.install(basis, k, totalDegree(basis[k]));
+      // f retires f*g, so (0, 2) is never formed, and (1, 2) is coprime. Only (0, 1) is left.
+      assert(pairs.size() == 1);
+      assert(!pairs.active(0) && pairs.active(1) && pairs.active(2));
+   }
+
+   template<typename SelectionStrategy>
+   BuchbergerStatistics testStrategy()
+   {
+      using PolynomialType = Polynomial<PolynomialRing<double, 5>, GrevlexOrder>;
+      auto generators = cyclic<PolynomialType>();
+      BuchbergerStatistics statistics;
+      auto groebner = runBuchbergers<SelectionStrategy>(generators, &statistics);
+      assert(isGroebnerBasis(groebner, generators));
+      assert(statistics.reductions == statistics.zero_reductions+groebner.size()-generators.size());
+      return statistics;
+   }
+
+   void testStrategies()
+   {
+      auto first = testStrategy<FirstPairStrategy>();
+      auto normal = testStrategy<NormalStrategy>();
+      auto sugar = testStrategy<SugarStrategy>();
+      assert((first.reductions > 0) && (normal.reductions > 0) && (sugar.reductions > 0));
+      assert(normal.pairs_discarded > 0);
+   }
+
+   void testPackedBuchbergers()
+   {
+      Polynomial<PackedRing2, GrevlexOrder> l1 { {1, {{2,0}}}, {-1, {{0,2}}} };
+      Polynomial<PackedRing2, GrevlexOrder> l2 { {1, {{2,0}}}, {1, {{0,1}}} };
+
+      // f1_reduced = x^2+y
+      Polynomial<PackedRing2, GrevlexOrder> f1_reduced { {1, {{2,0}}}, {1, {{0,1}}} };
+  
+      // f2_reduced = y^2+y
+      Polynomial<PackedRing2, GrevlexOrder> f2_reduced { {1, {{0,2}}}, {1, {{0,1}}} };
+
+      auto groebner = runBuchbergers({l1, l2});
+      makeMinimalGroebner(groebner); 
+      makeReducedGroebner(groebner);
+
+      assert(groebner.size() == 2);
+      assert(groebner[0] == f1_reduced);
+      assert(groebner[1] == f2_reduced);
+   }
+
+
+   // F4 yields a Groebner Basis with the same (minimal) leading monomials as Buchberger's.
+   template<typename PolynomialType>
+   void testF4()
+   {
+      auto generators = cyclic<PolynomialType>();
+      BuchbergerStatistics statistics;
+      auto groebner = runF4(generators, &statistics);
+      assert(isGroebnerBasis(groebner, generators));
+      assert(statistics.reductions > 0);
+
+      auto reference = runBuchbergers(generators);
+      makeMinimalGroebner(groebner);
+      makeMinimalGroebner(reference);
+      assert(groebner.size() == reference.size());
+      for (auto const &g: groebner)
+         assert(std::any_of(reference.begin(), reference.end(), [&g](auto const &r) {return LM(r) == LM(g);}));
+   }
+
+   void testF4()
+   {
+      testF4<Polynomial<PolyRing4, GrevlexOrder>>();
+      testF4<Polynomial<PolynomialRing<double, 5>, GrevlexOrder>>();
+      testF4<Polynomial<PackedRing5, GrlexOrder>>();
+   }
+
+
+   // The signature-based algorithm yields a Groebner Basis, while reducing fewer pairs to zero.
+   template<typename PolynomialType>
+   void testSignatureBuchbergers()
+   {
+      auto generators = cyclic<PolynomialType>();
+      BuchbergerStatistics statistics, reference_statistics;
+      auto groebner = runSignatureBuchbergers(generators, &statistics);
+      auto reference = runBuchbergers(generators, &reference_statistics);
+      assert(isGroebnerBasis(groebner, generators));
+      assert(statistics.zero_reductions < reference_statistics.zero_reductions);
+
+      makeMinimalGroebner(groebner);
+      makeMinimalGroebner(reference);
+      assert(groebner.size() == reference.size());
+      for (auto const &g: groebner)
+         assert(std::any_of(reference.begin(), reference.end(), [&g](auto const &r) {return LM(r) == LM(g);}));
+   }
+
+   void testSignatureBuchbergers()
+   {
+      testSignatureBuchbergers<Polynomial<PolyRing4, GrevlexOrder>>();
+      testSignatureBuchbergers<Polynomial<PackedPolynomialRing<double, 4>, GrlexOrder>>();
+
+      // The generators of testBuchbergers1, in lex.
+      Polynomial<PolyRing2, LexOrder> f {{1, {{3,0}}}, {-2, {{1,1}}}};
+      Polynomial<PolyRing2, LexOrder> g {{1, {{2,1}}}, {-2, {{0,2}}}, {1, {{1,0}}}};
+      auto groebner = runSignatureBuchbergers({f, g});
+      assert(isGroebnerBasis(groebner, std::deque<Polynomial<PolyRing2, LexOrder>> {f, g}));
+   }
+
+
+   // The index agrees with a linear scan for the first divisor.
+   template<typename PolyRing>
+   void testReducerIndex()
+   {
+      std::mt19937 gen(7);
+      std::uniform_int_distribution<unsigned int> power(0, 4);
+      auto randomMonomial = [&]() {
+         Monomial<PolyRing> m;
+         for (size_t i = 0; i < PolyRing::VARIABLES; ++i)
+            m.set(i, power(gen));
+         return m;
+      };
+
+      std::vector<Monomial<PolyRing>> monomials;
+      ReducerIndex<PolyRing> index;
+      for (size_t id = 0; id < 200; ++id)
+      {
+         monomials.push_back(randomMonomial());
+         index.insert(monomials.back(), id);
+      }
+      assert(index.size() == monomials.size());
+
+      for (size_t k = 0; k < 500; ++k)
+      {
+         auto m = randomMonomial();
+         m *= randomMonomial();
+         auto first = std::find_if(monomials.begin(), monomials.end(), [&m](auto const &d) {return divides(d, m);});
+         size_t expected = (first == monomials.end()) ? index.npos : (first-monomials.begin());
+         assert(index.find(m) == expected);
+         auto odd = std::find_if(monomials.begin(), monomials.end(), [&](auto const &d) {return ((&d-&monomials[0])%2 == 1) && divides(d, m);});
+         assert(index.find(m, [](size_t id) {return id%2 == 1;}) == ((odd == monomials.end()) ? index.npos : size_t(odd-monomials.begin())));
+      }
+   }
+
+   void testReducerIndex()
+   {
+      testReducerIndex<PolyRing3>();
+      testReducerIndex<PackedRing5>();
+   }
+
+   // No term of a reduced basis is divisible by the leading monomial of another element.
+   void testReducedGroebner()
+   {
+      using PolynomialType = Polynomial<PolyRing4, GrevlexOrder>;
+      auto generators = cyclic<PolynomialType>();
+      auto groebner = runBuchbergers(generators);
+      makeMinimalGroebner(groebner);
+      makeReducedGroebner(groebner);
+      assert(isGroebnerBasis(groebner, generators));
+      for (auto const &p: groebner)
+      {
+         assert(LC(p) == 1);
+         for (auto const &q: groebner)
+            for (size_t t = 1; t < q.terms(); ++t)
+               assert(!divides(LM(p), q.getMonomial(t)));
+      }
+   }
+
+
+   template<typename Field>
+   void testPrimeField()
+   {
+      const uint64_t p = Field::MODULUS;
+      std::mt19937_64 gen(11);
+      std::uniform_int_distribution<uint64_t> residue(1, p-1);
+      assert(Field(-1).value() == p-1);
+      assert((Field(-1)+Field(1)).isZero());
+      assert((-Field(5)).value() == p-5);
+      typename AccumulatorOf<Field>::type sum;
+      unsigned __int128 expected_sum = 0;
+      for (size_t i = 0; i < 1000; ++i)
+      {
+         uint64_t a = residue(gen), b = residue(gen);
+         Field fa(a), fb(b);
+         assert(fa.value() == a);
+         assert((fa*fb).value() == uint64_t((unsigned __int128)a*b%p));
+         assert((fa+fb).value() == uint64_t(((unsigned __int128)a+b)%p));
+         assert((fa-fb).value() == (a >= b ? a-b : a+(p-b)));
+         assert((fa*fa.inverse()).value() == 1);
+         assert((fa/fb)*fb == fa);
+         sum.addProduct(fa, fb);
+         expected_sum = (expected_sum+(unsigned __int128)a*b)%p;
+      }
+      assert(sum.value().value() == uint64_t(expected_sum));
+   }
+
+   // Two bases are equal up to the order of the elements (comparing the coefficients exactly).
+   template<typename BasisContainer>
+   bool sameBasis(BasisContainer const &b1, BasisContainer const &b2)
+   {
+      if (b1.size() != b2.size()) return false;
+      for (auto const &p: b1)
+      {
+         auto equal = [&p](auto const &q) {
+            if (!(p == q)) return false;
+            for (size_t t = 0; t < p.terms(); ++t)
+               if (p.getCoeff(t) != q.getCoeff(t)) return false;
+            return true;
+         };
+         if (std::none_of(b2.begin(), b2.end(), equal)) return false;
+      }
+      return true;
+   }
+
+   // Over a prime field the reduced basis is computed exactly, so all the engines agree on it.
+   template<typename PolyRing>
+   void testPrimeFieldGroebner()
+   {
+      using PolynomialType = Polynomial<PolyRing, GrevlexOrder>;
+      auto generators = cyclic<PolynomialType>();
+      BuchbergerStatistics statistics, signature_statistics;
+      auto groebner = runBuchbergers(generators, &statistics);
+      auto f4 = runF4(generators);
+      auto signature = runSignatureBuchbergers(generators, &signature_statistics);
+      assert(isGroebnerBasis(groebner, generators));
+      assert(signature_statistics.zero_reductions < statistics.zero_reductions);
+      for (auto *basis: {&groebner, &f4, &signature})
+      {
+         makeMinimalGroebner(*basis);
+         makeReducedGroebner(*basis);
+      }
+      assert(sameBasis(groebner, f4));
+      assert(sameBasis(groebner, signature));
+   }
+
+   void testPrimeFields()
+   {
+      testPrimeField<PrimeField<32003>>();
+      testPrimeField<PrimeField<4294967291u>>();
+      testPrimeField<PrimeField<4611686018427387847ull>>();
+      testPrimeField<PrimeField<9223372036854775783ull>>();
+      static_assert(std::is_same<PrimeField<4294967291u>, BarrettField<4294967291u>>::value, "");
+      static_assert(std::is_same<PrimeField<9223372036854775783ull>, MontgomeryField<9223372036854775783ull>>::value, "");
+
+      testPrimeFieldGroebner<PrimeFieldRing<32003, 5>>();
+      testPrimeFieldGroebner<PrimeFieldRing<9223372036854775783ull, 5, PackedExponents<5>>>();
+   }
+
+
+   void testBigInteger()
+   {
+      // The inline values agree with 128-bit arithmetic, also where they overflow.
+      std::mt19937_64 gen(13);
+      for (size_t i = 0; i < 1000; ++i)
+      {
+         int64_t a = int64_t(gen()) >> (gen()%64), b = int64_t(gen()) >> (gen()%64);
+         if (b == 0) b = 1;
+         __int128 sum = __int128(a)+b, product = __int128(a)*b;
+         auto big = [](__int128 v) {
+            bool negative = (v < 0);
+            unsigned __int128 m = negative ? -(unsigned __int128)v : v;
+            BigInteger res = BigInteger(int64_t(m >> 64))*BigInteger(1ll << 32)*BigInteger(1ll << 32)+BigInteger(int64_t(m & 0xFFFFFFFF))+
+                             BigInteger(int64_t((m >> 32) & 0xFFFFFFFF))*BigInteger(1ll << 32);
+            return negative ? -res : res;
+         };
+         assert(BigInteger(a)+BigInteger(b) == big(sum));
+         assert(BigInteger(a)*BigInteger(b) == big(product));
+         assert(BigInteger(a)-BigInteger(b) == big(__int128(a)-b));
+         assert((BigInteger(a)*BigInteger(b))/BigInteger(b) == BigInteger(a));
+         assert(big(product).isSmall() == ((product >= INT64_MIN) && (product <= INT64_MAX)));
+      }
+
+      // 2^200 / (3^50) and back.
+      BigInteger two_200 = 1, three_50 = 1;
+      for (int i = 0; i < 200; ++i) two_200 *= 2;
+      for (int i = 0; i < 50; ++i) three_50 *= 3;
+      assert(two_200.toString() == "1606938044258990275541962092341162602522202993782792835301376");
+      BigInteger q = two_200/three_50, r = two_200%three_50;
+      assert(q*three_50+r == two_200);
+      assert((r.sign() >= 0) && (r < three_50));
+      assert(gcd(two_200*three_50, three_50*BigInteger(1000)) == three_50*BigInteger(8));
+      assert((two_200-two_200+BigInteger(5)).isSmall());
+   }
+
+   void testRational()
+   {
+      Rational a(BigInteger(6), BigInteger(-4)), b(BigInteger(1), BigInteger(6));
+      assert(a == Rational(BigInteger(-3), BigInteger(2)));
+      assert(a+b == Rational(BigInteger(-4), BigInteger(3)));
+      assert(a*b == Rational(BigInteger(-1), BigInteger(4)));
+      assert(a/b == Rational(-9));
+      assert((a-a).isZero());
+      assert(Rational::gcd(Rational(BigInteger(4), BigInteger(3)), Rational(BigInteger(6), BigInteger(5))) == Rational(BigInteger(2), BigInteger(15)));
+      assert(a.toString() == "-3/2");
+   }
+
+   // Plain and fraction-free reductions over Q lead to the same reduced basis.
+   void testRationalGroebner()
+   {
+      using PolynomialType = Polynomial<RationalRing<4>, GrevlexOrder>;
+      auto generators = cyclic<PolynomialType>();
+      generators.push_back(PolynomialType {{Rational(BigInteger(3), BigInteger(7)), {{2,0,0,1}}}, {Rational(BigInteger(-5), BigInteger(2)), {{0,1,1,0}}},
+                                           {Rational(11), {{0,0,0,1}}}});
+
+      BuchbergerStatistics plain_statistics, primitive_statistics;
+      auto plain = runBuchbergers(generators, &plain_statistics);
+      auto primitive = runBuchbergers<NormalStrategy, PrimitiveReduction>(generators, &primitive_statistics);
+      assert(isGroebnerBasis(plain, generators));
+      assert(isGroebnerBasis(primitive, generators));
+      assert(plain_statistics.reductions == primitive_statistics.reductions);
+
+      // Fraction-free remainders have coprime integer coefficients.
+      for (size_t i = generators.size(); i < primitive.size(); ++i)
+      {
+         Rational content = 0;
+         for (size_t t = 0; t < primitive[i].terms(); ++t)
+         {
+            assert(primitive[i].getCoeff(t).isInteger());
+            content = Rational::gcd(content, primitive[i].getCoeff(t));
+         }
+         assert(content == 1);
+      }
+
+      for (auto *basis: {&plain, &primitive})
+      {
+         makeMinimalGroebner(*basis);
+         makeReducedGroebner(*basis);
+      }
+      assert(sameBasis(plain, primitive));
+   }
+
+   void testRationalReconstruction()
+   {
+      BigInteger m = BigInteger(2147483647)*BigInteger(2147483629);
+      // -22/7 = r (mod m), where 7*r = -22 (mod m).
+      BigInteger r = (m-BigInteger(22))%m;
+      while (!((r%BigInteger(7)).isZero())) r += m;
+      r = r/BigInteger(7);
+      Rational c;
+      assert(reconstructRational(r, m, c) && (c == Rational(BigInteger(-22), BigInteger(7))));
+      assert(reconstructRational(0, m, c) && c.isZero());
+      // Modulo 11, only 0, +-1, +-2 and +-1/2 can be reconstructed (their residues are 0, 1, 10, 2, 9, 6, 5).
+      assert(reconstructRational(5, 11, c) && (c == Rational(BigInteger(-1), BigInteger(2))));
+      assert(!reconstructRational(3, 11, c));
+   }
+
+   void testModularGroebner()
+   {
+      using PolynomialType = Polynomial<RationalRing<4>, GrevlexOrder>;
+      auto generators = cyclic<PolynomialType>();
+      generators.push_back(PolynomialType {{Rational(BigInteger(3), BigInteger(7)), {{2,0,0,1}}}, {Rational(BigInteger(-5), BigInteger(2)), {{0,1,1,0}}},
+                                           {Rational(11), {{0,0,0,1}}}});
+
+      auto direct = runBuchbergers<NormalStrategy, PrimitiveReduction>(generators);
+      makeMinimalGroebner(direct);
+      makeReducedGroebner(direct);
+
+      ModularStatistics statistics;
+      auto modular = runModularGroebner(generators, &statistics);
+      assert(!statistics.fallback);
+      assert(statistics.unlucky_primes == 0);
+      assert(statistics.combined_primes < statistics.primes);
+      assert(sameBasis(modular, direct));
+      for (size_t i = 1; i < modular.size(); ++i)
+         assert(GrevlexOrder::lessThen(LM(modular[i]), LM(modular[i-1])));
+
+      // The first prime divides a denominator.
+      generators.back() *= Rational(BigInteger(1), BigInteger(2147483647));
+      modular = runModularGroebner(generators, &statistics);
+      assert(!statistics.fallback);
+      assert(statistics.unlucky_primes == 1);
+      assert(sameBasis(modular, direct));
+
+      // A single prime never verifies a reconstruction.
+      modular = runModularGroebner<PrimeList<2147483629>>(generators, &statistics);
+      assert(statistics.fallback);
+      assert(sameBasis(modular, direct));
+
+      // Larger coefficients need more primes than the first round, so the later primes replay a trace.
+      generators.back() = PolynomialType {{Rational(BigInteger(123457), BigInteger(7)), {{2,0,0,1}}}, {Rational(BigInteger(-98765), BigInteger(13)), {{0,1,1,0}}},
+                                          {Rational(BigInteger(1000003), BigInteger(11)), {{0,0,0,1}}}};
+      direct = runBuchbergers<NormalStrategy, PrimitiveReduction>(generators);
+      makeMinimalGroebner(direct);
+      makeReducedGroebner(direct);
+      modular = runModularGroebner(generators, &statistics);
+      assert(!statistics.fallback);
+      assert(statistics.replayed_primes > 0);
+      assert(sameBasis(modular, direct));
+   }
+
+   // The same generators, with random coefficients (from 1 to 1000).
+   template<typename BasisContainer>
+   BasisContainer withRandomCoefficients(BasisContainer const &generators, unsigned int seed)
+   {
+      using PolynomialType = typename BasisContainer::value_type;
+      using PolyRing = typename PolynomialType::Ring;
+      std::mt19937 gen(seed);
+      std::uniform_int_distribution<int> coefficient(1, 1000);
+      BasisContainer res;
+      for (auto const &g: generators)
+      {
+         PolynomialType p;
+         for (size_t t = 0; t < g.terms(); ++t)
+            p += Term<PolyRing>(typename PolyRing::Coefficient(coefficient(gen)), g.getMonomial(t));
+         res.push_back(p);
+      }
+      return res;
+   }
+
+   void testBuchbergerTrace()
+   {
+      using PolynomialType = Polynomial<PrimeFieldRing<2147483647, 5>, GrevlexOrder>;
+      auto traced = withRandomCoefficients(cyclic<PolynomialType>(), 1);
+      auto other = withRandomCoefficients(cyclic<PolynomialType>(), 2);
+
+      BuchbergerTrace trace;
+      BuchbergerStatistics statistics, replay_statistics;
+      runBuchbergers(traced, nullptr, &trace);
+      auto expected = runBuchbergers(other, &statistics);
+      std::deque<PolynomialType> replayed;
+      assert(replayBuchbergers(other, trace, replayed, &replay_statistics));
+      assert(sameBasis(replayed, expected));
+      assert(replay_statistics.reductions == statistics.reductions-statistics.zero_reductions);
+
+      // The trace holds no coefficients, so it is replayed modulo another prime as well.
+      using OtherPolynomialType = Polynomial<PrimeFieldRing<2147483629, 5>, GrevlexOrder>;
+      auto other_prime = withRandomCoefficients(cyclic<OtherPolynomialType>(), 2);
+      std::deque<OtherPolynomialType> other_replayed;
+      assert(replayBuchbergers(other_prime, trace, other_replayed));
+      assert(sameBasis(other_replayed, runBuchbergers(other_prime)));
+
+      // Generators with other leading monomials do not follow the trace.
+      other.front() -= LT(other.front());
+      assert(!replayBuchbergers(other, trace, replayed));
+   }
+
+
+   void testThreadPool()
+   {
+      for (size_t threads: {0, 1, 4})
+      {
+         ThreadPool pool(threads);
+         assert(pool.threads() == threads);
+         for (size_t count: {0, 1, 3, 1000})
+         {
+            // Uneven tasks (later tasks are longer), so some are stolen.
+            std::vector<size_t> results(count, 0);
+            pool.run(count, [&results](size_t i) {
+               size_t sum = 0;
+               for (size_t k = 0; k <= i*10; ++k) sum += k;
+               results[i] = sum;
+            });
+            for (size_t i = 0; i < count; ++i)
+               assert(results[i] == (i*10)*(i*10+1)/2);
+         }
+      }
+   }
+
+   void testParallelBuchbergers()
+   {
+      using PolynomialType = Polynomial<PrimeFieldRing<2147483647, 5>, GrevlexOrder>;
+      auto generators = withRandomCoefficients(cyclic<PolynomialType>(), 3);
+
+      // The result does not depend on the number of threads (the elements and their order are the same).
+      std::deque<PolynomialType> reference;
+      for (size_t threads: {0, 1, 2, 4})
+      {
+         ThreadPool pool(threads);
+         BuchbergerStatistics statistics;
+         auto groebner = runParallelBuchbergers(generators, pool, &statistics);
+         assert(statistics.reductions >= statistics.zero_reductions);
+         if (threads == 0)
+         {
+            assert(isGroebnerBasis(groebner, generators));
+            reference = groebner;
+            continue;
+         }
+         assert(groebner.size() == reference.size());
+         for (size_t i = 0; i < groebner.size(); ++i)
+         {
+            assert(groebner[i] == reference[i]);
+            for (size_t t = 0; t < groebner[i].terms(); ++t)
+               assert(groebner[i].getCoeff(t) == reference[i].getCoeff(t));
+         }
+      }
+
+      makeMinimalGroebner(reference);
+      makeReducedGroebner(reference);
+      auto serial = runBuchbergers(generators);
+      makeMinimalGroebner(serial);
+      makeReducedGroebner(serial);
+      assert(sameBasis(reference, serial));
+   }
+
+   void testParallelMultiplication()
+   {
+      using PolynomialType = Polynomial<PrimeFieldRing<2147483647, 3>, GrlexOrder>;
+      std::mt19937 gen(9);
+      for (size_t iteration = 0; iteration < 5; ++iteration)
+      {
+         auto p1 = randomPolynomial<PolynomialType>(gen, 60, 6);
+         auto p2 = randomPolynomial<PolynomialType>(gen, 20+30*iteration, 6);
+         auto serial = p1*p2;
+
+         // The bands are merged exactly like the serial product, so the results are identical.
+         for (size_t threads: {0, 1, 2, 3})
+         {
+            ThreadPool pool(threads);
+            auto product = multiplyParallel(p1, p2, pool, 0);
+            assert(product.terms() == serial.terms());
+            for (size_t t = 0; t < product.terms(); ++t)
+            {
+               assert(product.getMonomial(t) == serial.getMonomial(t));
+               assert(product.getCoeff(t) == serial.getCoeff(t));
+            }
+         }
+      }
+
+      // Operands with a single term, and with none.
+      ThreadPool pool(2);
+      PolynomialType x {{1, {{1,0,0}}}};
+      auto p = randomPolynomial<PolynomialType>(gen, 30, 4);
+      assert(multiplyParallel(x, p, pool, 0) == x*p);
+      assert(multiplyParallel(p, PolynomialType(), pool, 0).terms() == 0);
+   }
+
+   void testGeobucket()
+   {
+      using PolynomialType = Polynomial<PrimeFieldRing<2147483647, 3>, GrevlexOrder>;
+      using TermType = PolynomialType::TermType;
+      std::mt19937 gen(11);
+
+      // Summands of very different sizes, so the buckets are carried into each other.
+      Geobucket<PolynomialType> bucket;
+      PolynomialType chained;
+      for (size_t i = 0; i < 300; ++i)
+      {
+         auto p = randomPolynomial<PolynomialType>(gen, 1+(i*i)%97, 5);
+         if (i%3 == 0)
+         {
+            TermType multiplier(7, Monomial<PolynomialType::Ring>({1,0,2}));
+            bucket.add(multiplier, p, 1);
+            PolynomialType tail(p);
+            if (p.terms() != 0) tail -= LT(p);
+            chained += multiplier*tail;
+         }
+         else if (i%3 == 1)
+         {
+            bucket -= p;
+            chained -= p;
+         }
+         else
+         {
+            bucket += p;
+            chained += p;
+         }
+      }
+      auto sum = bucket.sum();
+      assert(sum == chained);
+      for (size_t t = 0; t < sum.terms(); ++t)
+         assert(sum.getCoeff(t) == chained.getCoeff(t));
+      assert(bucket.sum() == chained);
+
+      // Popping the leading terms yields the sum, term by term.
+      TermType leading;
+      for (size_t t = 0; t < chained.terms(); ++t)
+      {
+         assert(bucket.popLeadingTerm(leading));
+         assert(leading == chained[t]);
+      }
+      assert(!bucket.popLeadingTerm(leading));
+
+      // Cancellation across buckets.
+      Geobucket<PolynomialType> cancelled;
+      auto p = randomPolynomial<PolynomialType>(gen, 50, 5);
+      cancelled += p;
+      cancelled += randomPolynomial<PolynomialType>(gen, 3, 5);
+      cancelled -= cancelled.sum();
+      assert(!cancelled.popLeadingTerm(leading));
+      assert(cancelled.sum().terms() == 0);
+   }
+
+   // Counts the bytes allocated (from new/delete) and not yet released.
+   class CountingResource : public std::pmr::memory_resource
+   {
+   public:
+      size_t outstanding = 0;
+      size_t allocations = 0;
+
+   private:
+      void* do_allocate(size_t bytes, size_t alignment) override
+      {
+         outstanding += bytes;
+         ++allocations;
+         return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+      }
+      void do_deallocate(void *p, size_t bytes, size_t alignment) override
+      {
+         outstanding -= bytes;
+         std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+      }
+      bool do_is_equal(std::pmr::memory_resource const &other) const noexcept override {return this == &other;}
+   };
+
+   void testPolynomialArena()
+   {
+      using PolynomialType = Polynomial<PrimeFieldRing<2147483647, 6>, GrevlexOrder>;
+      auto generators = cyclic<PolynomialType>();
+      auto reference = runBuchbergers(generators);
+
+      CountingResource counting;
+      auto *previous = currentPolynomialResource();
+      currentPolynomialResource() = &counting;
+      {
+         auto groebner = runBuchbergers(generators);
+         assert(currentPolynomialResource() == &counting);
+         assert(groebner.size() == reference.size());
+         for (size_t i = 0; i < groebner.size(); ++i)
+         {
+            assert(groebner[i] == reference[i]);
+            for (size_t t = 0; t < groebner[i].terms(); ++t)
+               assert(groebner[i].getCoeff(t) == reference[i].getCoeff(t));
+         }
+
+         // The arena allocates in large blocks (far fewer than the polynomials of the run), and it is
+         // released with the run, so only the copied basis is left.
+         size_t basis_allocations = 2*groebner.size();
+         assert(counting.allocations < 10*basis_allocations);
+         makeMinimalGroebner(groebner);
+         makeReducedGroebner(groebner);
+      }
+      assert(counting.outstanding == 0);
+
+      // Copies follow the current resource, and outside() copies out of the arena.
+      {
+         PolynomialType out;
+         {
+            PolynomialArena arena;
+            PolynomialType copied(generators[0]);
+            copied *= Term<PolynomialType::Ring>(3, Monomial<PolynomialType::Ring>());
+            out = arena.outside([&copied] {return PolynomialType(copied);});
+            assert(counting.outstanding > 0);
+         }
+         assert(out == generators[0]);
+         assert(out.getCoeff(0) == PolynomialType::Ring::Coefficient(3)*generators[0].getCoeff(0));
+      }
+      currentPolynomialResource() = previous;
+      assert(counting.outstanding == 0);
+   }
+
+   // A monitored run stops at its limits with a partial basis, which a second run completes.
+   void testBuchbergerMonitor()
+   {
+      using PolynomialType = Polynomial<PrimeFieldRing<2147483647, 6>, GrevlexOrder>;
+      auto generators = cyclic<PolynomialType>();
+      auto reduced = [](std::deque<PolynomialType> basis) {
+         makeMinimalGroebner(basis);
+         makeReducedGroebner(basis);
+         return basis;
+      };
+      auto reference = reduced(runBuchbergers(generators));
+
+      {
+         BuchbergerMonitor monitor;
+         auto groebner = runBuchbergers(generators, nullptr, nullptr, &monitor);
+         assert(monitor.stopped() == BuchbergerMonitor::Stop::None);
+         assert(monitor.basis_size == groebner.size());
+         assert(monitor.pairs_remaining == 0);
+         assert(monitor.degree > 0);
+         assert(sameBasis(reduced(groebner), reference));
+      }
+      {
+         BuchbergerMonitor monitor;
+         monitor.cancel();
+         auto partial = runBuchbergers(generators, nullptr, nullptr, &monitor);
+         assert(monitor.stopped() == BuchbergerMonitor::Stop::Cancelled);
+         assert(partial.size() == generators.size());
+         assert(monitor.pairs_remaining > 0);
+      }
+      {
+         BuchbergerMonitor monitor;
+         monitor.deadline = std::chrono::steady_clock::now();
+         auto partial = runBuchbergers(generators, nullptr, nullptr, &monitor);
+         assert(monitor.stopped() == BuchbergerMonitor::Stop::Deadline);
+         assert(partial.size() == generators.size());
+      }
+      {
+         // The run's arena is allocated from the metered resource, so any limit below its first block stops it.
+         MeteredResource metered;
+         BuchbergerMonitor monitor;
+         monitor.memory = &metered;
+         monitor.memory_limit = 1;
+         auto *previous = currentPolynomialResource();
+         currentPolynomialResource() = &metered;
+         {
+            auto partial = runBuchbergers(generators, nullptr, nullptr, &monitor);
+            assert(monitor.stopped() == BuchbergerMonitor::Stop::Memory);
+            assert(partial.size() == generators.size());
+            assert(metered.bytes() > 0);
+         }
+         currentPolynomialResource() = previous;
+         assert(metered.bytes() == 0);
+      }
+      {
+         // Cancelled from another thread at an arbitrary point: whatever was found still generates the ideal.
+         BuchbergerMonitor monitor;
+         std::deque<PolynomialType> partial;
+         std::atomic<bool> done {false};
+         std::thread run([&] {
+            partial = runBuchbergers(generators, nullptr, nullptr, &monitor);
+            done = true;
+         });
+         while (!done && (monitor.basis_size <= generators.size()))
+            std::this_thread::yield();
+         monitor.cancel();
+         run.join();
+         assert(partial.size() >= generators.size());
+         assert(sameBasis(reduced(runBuchbergers(partial)), reference));
+      }
+   }
+
+   template<typename Target, typename Source>
+   Target convertPolynomial(Source const &p)
+   {
+      using Ring = typename Target::Ring;
+      Target q;
+      for (size_t t = 0; t < p.terms(); ++t)
+      {
+         Monomial<Ring> m;
+         for (size_t i = 0; i < variablesOf<typename Source::Ring>(); ++i)
+            m.set(i, p.getMonomial(t)[i]);
+         q += Term<Ring>(p.getCoeff(t), m);
+      }
+      return q;
+   }
+
+   // A ring sized at runtime computes the same reduced basis as the compile-time one, with inline and with pooled powers.
+   template<size_t INLINE, typename MonomialOrdering>
+   void testRuntimeRing(OrderingId ordering)
+   {
+      const uint64_t P = 2147483647;
+      using FixedType = Polynomial<PrimeFieldRing<P, 5>, MonomialOrdering>;
+      using RuntimeExponentsType = RuntimeExponents<INLINE>;
+      using RuntimeType = Polynomial<PrimeFieldRing<P, RuntimeExponentsType::VARIABLES, RuntimeExponentsType>, RuntimeOrder>;
+      RuntimeExponentsType::load(5, ordering);
+      {
+         auto groebner = runBuchbergers(cyclic<RuntimeType>());
+         makeMinimalGroebner(groebner);
+         makeReducedGroebner(groebner);
+         std::deque<FixedType> converted;
+         for (auto const &g: groebner)
+            converted.push_back(convertPolynomial<FixedType>(g));
+
+         auto expected = runBuchbergers(cyclic<FixedType>());
+         makeMinimalGroebner(expected);
+         makeReducedGroebner(expected);
+         assert(sameBasis(converted, expected));
+
+         Monomial<typename RuntimeType::Ring> x({1,2,0,0,3});
+         assert(x.toString() == "<1,2,0,0,3>");
+         assert(x.powersSum() == 6);
+      }
+      RuntimeExponentsType::load(0, OrderingId::Lex);
+   }
+
+   void testRuntimeRings()
+   {
+      testRuntimeRing<8, GrevlexOrder>(OrderingId::Grevlex); // Inline.
+      testRuntimeRing<4, GrevlexOrder>(OrderingId::Grevlex); // Pooled.
+      testRuntimeRing<4, GrlexOrder>(OrderingId::Grlex);
+      testRuntimeRing<8, LexOrder>(OrderingId::Lex);
+   }
+
 
 } // namespace Tests
 